@@ -5,9 +5,16 @@ TEMPLATE = app
 
 unix:!macx {
     LIBS += -lGLU
+    # Offscreen renders create their context through EGL, see OffscreenContext.
+    DEFINES += HAIR_EGL
+    LIBS += -lEGL
     QMAKE_CXXFLAGS += -std=c++11
     CONFIG += debug_and_release
 }
+# qmake CONFIG+=avx2 widens the strand solver from SSE to AVX2, see simdfloat.h.
+avx2 {
+    QMAKE_CXXFLAGS += -mavx2 -mfma
+}
 macx {
     QMAKE_MACOSX_DEPLOYMENT_TARGET=10.9
     QMAKE_CFLAGS_X86_64 += -mmacosx-version-min=10.7
@@ -36,14 +43,20 @@ SOURCES += \
     src/ui/mainwindow.cpp \
     src/main.cpp \
     src/glwidget.cpp \
+    src/renderer.cpp \
+    src/batchrenderer.cpp \
+    src/offscreencontext.cpp \
     src/lib/resourceloader.cpp \
     src/lib/openglshape.cpp \
     src/lib/errorchecker.cpp \
     src/hairobject.cpp \
-    src/mike/hair.cpp \
+    src/mike/strandset.cpp \
+    src/mike/fluidgrid.cpp \
     src/mike/simulation.cpp \
+    src/mike/strandsolver.cpp \
+    src/mike/forcefield.cpp \
+    src/mike/guideskinning.cpp \
     src/shaderPrograms/shaderprogram.cpp \
-    src/mike/integrator.cpp \
     src/lib/objloader.cpp \
     src/objmesh.cpp \
     src/shaderPrograms/hairshaderprogram.cpp \
@@ -54,28 +67,44 @@ SOURCES += \
     src/framebuffer.cpp \
     src/quad.cpp \
     src/shaderPrograms/hairopacityshaderprogram.cpp \
-    src/meshocttree.cpp \
+    src/meshquery.cpp \
+    src/meshsdf.cpp \
     src/md5.cpp \
     src/tessellator.cpp \
+    src/strandbuffer.cpp \
+    src/hizbuffer.cpp \
+    src/scenecache.cpp \
+    src/simulationcache.cpp \
+    src/asyncreadback.cpp \
     src/shaderPrograms/hairfeedbackshaderprogram.cpp \
     src/ui/sceneeditor.cpp \
     src/ui/scenewidget.cpp \
     src/lib/blurrer.cpp \
+    src/lib/threadpool.cpp \
+    src/lib/hairloader.cpp \
+    src/lib/mappedfile.cpp \
+    src/lib/exrwriter.cpp \
     src/lib/ply_io.cpp \
     src/lib/PlyModel.cpp
 
 HEADERS += \
     src/ui/mainwindow.h \
     src/glwidget.h \
+    src/renderer.h \
+    src/batchrenderer.h \
+    src/offscreencontext.h \
     src/lib/resourceloader.h \
     src/lib/openglshape.h \
     src/lib/errorchecker.h \
     src/hairobject.h \
     src/hairCommon.h \
-    src/mike/hair.h \
+    src/mike/strandset.h \
+    src/mike/fluidgrid.h \
     src/mike/simulation.h \
+    src/mike/strandsolver.h \
+    src/mike/forcefield.h \
+    src/mike/guideskinning.h \
     src/shaderPrograms/shaderprogram.h \
-    src/mike/integrator.h \
     src/lib/objloader.hpp \
     src/objmesh.h \
     src/shaderPrograms/hairshaderprogram.h \
@@ -86,18 +115,34 @@ HEADERS += \
     src/framebuffer.h \
     src/quad.h \
     src/shaderPrograms/hairopacityshaderprogram.h \
-    src/meshocttree.h \
+    src/meshquery.h \
+    src/meshsdf.h \
     src/shaderPrograms/whitemeshshaderprogram.h \
     src/shaderPrograms/whitehairshaderprogram.h \
     src/md5.h \
     src/tessellator.h \
+    src/strandbuffer.h \
+    src/hizbuffer.h \
+    src/scenecache.h \
+    src/simulationcache.h \
+    src/asyncreadback.h \
     src/shaderPrograms/hairfeedbackshaderprogram.h \
     src/shaderPrograms/hairrendershaderprogram.h \
     src/ui/sceneeditor.h \
     src/ui/scenewidget.h \
     src/lib/blurrer.h \
+    src/lib/threadpool.h \
+    src/lib/simdfloat.h \
+    src/lib/pcgrandom.h \
+    src/lib/hairloader.h \
+    src/lib/mappedfile.h \
+    src/lib/exrwriter.h \
     src/shaderPrograms/hairdepthpeelprogram.h \
     src/shaderPrograms/meshdepthpeelprogram.h \
+    src/shaderPrograms/hairoitprogram.h \
+    src/shaderPrograms/oitcompositeshaderprogram.h \
+    src/shaderPrograms/meshdepthshaderprogram.h \
+    src/shaderPrograms/hizdownsampleshaderprogram.h \
     src/lib/ply_io.h \
     src/lib/PlyModel.h
 
@@ -121,11 +166,17 @@ OTHER_FILES += \
     shaders/hairrender.vert \
     shaders/depthpeel.glsl \
     shaders/hairDepthPeel.frag \
+    shaders/weightedblending.glsl \
+    shaders/hairOIT.frag \
+    shaders/oitcomposite.frag \
     shaders/hairlighting.glsl \
     shaders/meshlighting.glsl \
     shaders/meshdepthpeel.frag \
+    shaders/meshdepth.frag \
+    shaders/hizdownsample.frag \
     shaders/hairFeedback.geom \
-    shaders/hairFeedback.tes
+    shaders/hairFeedback.tes \
+    shaders/strands.glsl
 
 RESOURCES += \
     shaders/shaders.qrc \
@@ -0,0 +1,16 @@
+#version 400 core
+
+#include "hairlighting.glsl"
+#include "weightedblending.glsl"
+
+in vec4 position_g;
+in vec3 tangent_g;
+in float colorVariation_g;
+
+layout(location = 0) out vec4 accumulation;
+layout(location = 1) out vec4 revealage;
+
+void main()
+{
+    weightedBlend(hairLighting(position_g, tangent_g, colorVariation_g), accumulation, revealage);
+}
@@ -4,7 +4,7 @@
 
 uniform sampler2D shadowMap;
 uniform mat4 projection;
-uniform float occlusionLayerSize;
+uniform float opacityLayerSize; // Light depth of the first layer; each next one is twice as deep.
 
 in vec4 position_g;
 
@@ -22,11 +22,11 @@ void main(){
     float currDepth = shadowCoord.z;
 
     opacityMap = vec4(0.0);
-    if (currDepth < shadowMapDepth + (1) * OPACITY_MAP_LAYER_SIZE)
+    if (currDepth < shadowMapDepth + (1) * opacityLayerSize)
         opacityMap.r = A;
-    else if (currDepth < shadowMapDepth + (1 + 2) * OPACITY_MAP_LAYER_SIZE)
+    else if (currDepth < shadowMapDepth + (1 + 2) * opacityLayerSize)
         opacityMap.g = A;
-    else if (currDepth < shadowMapDepth + (1 + 2 + 4) * OPACITY_MAP_LAYER_SIZE)
+    else if (currDepth < shadowMapDepth + (1 + 2 + 4) * opacityLayerSize)
         opacityMap.b = A;
     else
         opacityMap.a = A;
@@ -2,7 +2,7 @@
 #include "opacitymapping.glsl"
 
 in float tessx_g;
-uniform vec3 color;
+in vec3 color_g; // Per-strand hair color.
 
 uniform float specIntensity, diffuseIntensity;
 uniform mat4 view, eyeToLight;
@@ -32,7 +32,7 @@ vec3 colorContribution(
     // Add color gradient
     colorMultiplier *= mix(MIN_COLOR, 1.0, smoothstep(MIN_COLOR_END, MAX_COLOR_START, tessx_g));
 
-    return (diffuseIntensity * diffuse + specIntensity * specular) * color * colorMultiplier;
+    return (diffuseIntensity * diffuse + specIntensity * specular) * color_g * colorMultiplier;
 }
 
 vec4 hairLighting(in vec4 position_ES, in vec3 tangent_ES, in float colorVariation)
@@ -4,11 +4,14 @@ layout(location = 0) in vec3 position;
 layout(location = 1) in vec3 tangent;
 layout(location = 2) in float colorVariation;
 layout(location = 3) in float tessx;
+layout(location = 4) in vec3 strandColor;
+layout(location = 5) in float widthScale;
 
 out vec4 position_g;
 out vec3 tangent_g;
 out float colorVariation_g;
 out float tessx_g;
+out vec3 color_g;
 
 uniform mat4 projection, view;
 uniform float taperExponent;
@@ -20,14 +23,16 @@ void main()
     vec4 position_ES = view * vec4(position, 1.0);
     vec3 tangent_ES = (view * vec4(tangent, 0.0)).xyz;
 
-    // Offset position.
+    // Offset position to the side given by the sign of tessx (see hairFeedback.geom).
+    float x = max(abs(tessx) - 1.0, 0.0);
     vec3 offsetDir = cross(normalize(tangent_ES), normalize(position_ES.xyz));
-    position_ES.xyz += sign(tessx) * hairRadius * (1.0 - pow(abs(tessx), taperExponent)) * offsetDir;
+    position_ES.xyz += sign(tessx) * hairRadius * widthScale * (1.0 - pow(x, taperExponent)) * offsetDir;
     gl_Position = projection * position_ES;
 
     // Send outputs to frag shader.
     position_g = position_ES;
     tangent_g = tangent_ES;
     colorVariation_g = colorVariation;
-    tessx_g = abs(tessx);
+    tessx_g = x;
+    color_g = strandColor;
 }
@@ -0,0 +1,17 @@
+#version 400 core
+
+// Only the level below is in the mip range while a level is written (see
+// HiZBuffer::end), so it is level 0 to texelFetch.
+uniform sampler2D hiZMap;
+
+out float fragDepth;
+
+// Farthest depth of the 2x2 texels of the level below.
+void main(){
+    ivec2 texel = 2 * ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(hiZMap, texel, 0).r;
+    depth = max(depth, texelFetch(hiZMap, texel + ivec2(1, 0), 0).r);
+    depth = max(depth, texelFetch(hiZMap, texel + ivec2(0, 1), 0).r);
+    depth = max(depth, texelFetch(hiZMap, texel + ivec2(1, 1), 0).r);
+    fragDepth = depth;
+}
@@ -0,0 +1,7 @@
+#version 400 core
+
+out float fragDepth;
+
+void main(){
+    fragDepth = gl_FragCoord.z;
+}
@@ -0,0 +1,16 @@
+#version 400 core
+
+in vec2 uv_v;
+
+uniform sampler2D accumulationMap;
+uniform sampler2D revealageMap;
+
+out vec4 fragColor;
+
+// Resolves the weighted blended layers into their average color, with alpha
+// set to how much of the opaque scene behind shows through.
+void main(){
+    vec4 accumulation = texture(accumulationMap, uv_v);
+    float revealage = texture(revealageMap, uv_v).r;
+    fragColor = vec4(accumulation.rgb / max(accumulation.a, 1e-5), revealage);
+}
@@ -3,6 +3,7 @@ uniform sampler2DShadow meshShadowMap;
 uniform sampler2D opacityMap;
 uniform float shadowIntensity;
 uniform bool useShadows;
+uniform float opacityLayerSize; // Light depth of the first opacity map layer; each next one is twice as deep.
 
 float currDepth;
 
@@ -13,7 +14,7 @@ float occlusionSample(vec2 uv)
     vec4 opacityMapValues = texture(opacityMap, uv);
 
     float occlusion = 0.; // Amount of occlusion from opacity map layers
-    float layerSize = OPACITY_MAP_LAYER_SIZE; // Size of current layer
+    float layerSize = opacityLayerSize; // Size of current layer
     float layerStart = texelFetch(hairShadowMap, ivec2(uv * textureSize(hairShadowMap, 0)), 0).r;
 
     for (int layer = 0; layer < 4; layer++)
@@ -0,0 +1,82 @@
+// Guide hair data for all strands, packed by StrandBuffer. Each patch is one
+// guide hair and is looked up by gl_PrimitiveID, so a single draw covers all hair.
+uniform samplerBuffer strandVertices; // xyz position per vertex
+uniform isamplerBuffer strandRanges;  // first vertex, number of vertices
+uniform samplerBuffer strandData;     // 3 texels per strand: triangleFace[0] + length, triangleFace[1], color
+
+uniform float hairGroupSpread;
+uniform float noiseAmplitude;
+uniform float noiseFrequency;
+
+uniform sampler2D noiseTexture;
+
+// Per-strand values, set by loadStrand().
+int firstVertex;
+int numHairSegments;
+vec3 triangleFace[2];
+float hairLength;
+vec3 strandColor;
+
+void loadStrand(int strand)
+{
+    ivec2 range = texelFetch(strandRanges, strand).xy;
+    firstVertex = range.x;
+    numHairSegments = range.y - 1;
+
+    vec4 face0 = texelFetch(strandData, 3 * strand);
+    triangleFace[0] = face0.xyz;
+    hairLength = face0.w;
+    triangleFace[1] = texelFetch(strandData, 3 * strand + 1).xyz;
+    strandColor = texelFetch(strandData, 3 * strand + 2).xyz;
+}
+
+float rand( vec2 p )
+{
+    return fract(sin(dot(p,vec2(12.9898,78.233))) * 43758.5453);
+}
+
+vec3 spline(float tessCoordX)
+{
+    // 0 -------- 1 -----X-- 2 -------- 3
+    //              <--->
+    //                t
+
+    float f = clamp(tessCoordX, 0.0, 1.0) * numHairSegments;
+
+    float t = fract(f);
+
+    int index1 = int(f);
+    int index0 = max(index1 - 1, 0);
+    int index2 = min(index1 + 1, numHairSegments);
+    int index3 = min(index2 + 1, numHairSegments);
+
+    vec3 p0 = texelFetch(strandVertices, firstVertex + index0).xyz;
+    vec3 p1 = texelFetch(strandVertices, firstVertex + index1).xyz;
+    vec3 p2 = texelFetch(strandVertices, firstVertex + index2).xyz;
+    vec3 p3 = texelFetch(strandVertices, firstVertex + index3).xyz;
+
+    vec3 m1 = (p2 - p0) / 2.0;
+    vec3 m2 = (p1 - p3) / 2.0;
+
+    return mix(p1 + m1 * t, p2 + m2 * (1-t), smoothstep(0.0, 1.0, t));
+}
+
+vec3 shiftedSpline(in vec2 tessCoord)
+{
+    vec3 pos = spline(tessCoord.x);
+
+    // Offset each hair uniformly in circle around guide hair.
+    float r = sqrt(rand(vec2(tessCoord.y)));
+    float theta = 6.283 * rand(vec2(0.9 * tessCoord.y));
+    pos += hairGroupSpread * r * cos(theta) * triangleFace[0];
+    pos += hairGroupSpread * r * sin(theta) * triangleFace[1];
+
+    // Apply noise to offset position.
+    float noise = noiseAmplitude * tessCoord.x;
+    tessCoord *= vec2(noiseFrequency * (2 * hairLength), 0.2);
+    pos.x += noise * (1.0 - 2.0 * texture(noiseTexture, tessCoord.xy).r) * 0.5;
+    pos.y += noise * (1.0 - 2.0 * texture(noiseTexture, tessCoord.xy + .1).r) * 0.5;
+    pos.z += noise * (1.0 - 2.0 * texture(noiseTexture, tessCoord.xy + .2).r) * 0.5;
+
+    return pos;
+}
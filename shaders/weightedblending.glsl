@@ -0,0 +1,14 @@
+/**
+ * Weighted blended order-independent transparency (McGuire and Bavoil 2013).
+ * Every transparent fragment adds its premultiplied color to the accumulation
+ * target, weighted so that fragments near the camera count more, and
+ * multiplies the revealage target (cleared to one) by how much of what is
+ * behind it stays visible. Fragments can arrive in any order, so all layers
+ * of hair are blended in a single pass.
+ */
+void weightedBlend(in vec4 color, out vec4 accumulation, out vec4 revealage)
+{
+    float weight = color.a * clamp(3e3 * pow(1.0 - gl_FragCoord.z, 3.0), 1e-2, 3e3);
+    accumulation = vec4(color.rgb * color.a, color.a) * weight;
+    revealage = vec4(color.a);
+}
@@ -0,0 +1,152 @@
+#include "asyncreadback.h"
+
+#include "framebuffer.h"
+#include "errorchecker.h"
+#include "exrwriter.h"
+
+#include <QImage>
+#include <QRunnable>
+#include <QThread>
+
+// Frames waiting for an encoder on top of the ones being encoded.
+#define MAX_QUEUED_FRAMES 4
+
+// Flips a frame read from OpenGL, which stores the bottom row first, and writes it.
+class ImageEncoder : public QRunnable
+{
+public:
+    ImageEncoder(const QImage &image, const std::string &filename,
+                 QSemaphore *slots, std::atomic<int> *numFailed)
+        : m_image(image),
+          m_filename(filename),
+          m_slots(slots),
+          m_numFailed(numFailed)
+    {
+    }
+
+    void run()
+    {
+        // Swap rows in place instead of making a mirrored copy.
+        int height = m_image.height();
+        int lineSize = m_image.bytesPerLine();
+        std::vector<uchar> temp(lineSize);
+        for (int y = 0; y < height / 2; y++)
+        {
+            uchar *top = m_image.scanLine(y);
+            uchar *bottom = m_image.scanLine(height - 1 - y);
+            memcpy(temp.data(), top, lineSize);
+            memcpy(top, bottom, lineSize);
+            memcpy(bottom, temp.data(), lineSize);
+        }
+
+        std::string extension = m_filename.substr(m_filename.find_last_of('.') + 1);
+        bool saved = extension == "exr" || extension == "EXR" ?
+                    EXRWriter::write(m_filename.c_str(), m_image) :
+                    m_image.save(m_filename.c_str());
+        if (!saved)
+        {
+            cerr << "Could not save " << m_filename << endl;
+            (*m_numFailed)++;
+        }
+
+        m_slots->release();
+    }
+
+private:
+    QImage m_image;
+    std::string m_filename;
+    QSemaphore *m_slots;
+    std::atomic<int> *m_numFailed;
+};
+
+AsyncReadback::AsyncReadback(int width, int height, int numBuffers)
+    : m_encoderSlots(QThread::idealThreadCount() + MAX_QUEUED_FRAMES)
+{
+    m_width = width;
+    m_height = height;
+    m_nextSlot = 0;
+    m_numFailed = 0;
+
+    m_slots.resize(std::max(numBuffers, 1));
+    for (unsigned int i = 0; i < m_slots.size(); i++)
+    {
+        glGenBuffers(1, &m_slots[i].buffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, m_slots[i].buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, 4 * width * height, NULL, GL_STREAM_READ);
+        m_slots[i].fence = 0;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    ErrorChecker::printGLErrors("end of AsyncReadback::AsyncReadback");
+}
+
+AsyncReadback::~AsyncReadback()
+{
+    finish();
+    for (unsigned int i = 0; i < m_slots.size(); i++)
+        glDeleteBuffers(1, &m_slots[i].buffer);
+}
+
+void AsyncReadback::read(Framebuffer *source, const std::string &filename)
+{
+    Slot &slot = m_slots[m_nextSlot];
+    m_nextSlot = (m_nextSlot + 1) % m_slots.size();
+
+    // The frame read into this buffer last time around is done by now.
+    _collect(slot);
+
+    source->bind(GL_READ_FRAMEBUFFER);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    source->unbind(GL_READ_FRAMEBUFFER);
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.filename = filename;
+
+    ErrorChecker::printGLErrors("AsyncReadback::read");
+}
+
+void AsyncReadback::_collect(Slot &slot)
+{
+    if (slot.fence == 0)
+        return;
+
+    while (glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED);
+    glDeleteSync(slot.fence);
+    slot.fence = 0;
+
+    QImage image(m_width, m_height, QImage::Format_RGBX8888);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    const void *pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, 4 * m_width * m_height, GL_MAP_READ_BIT);
+    if (pixels != NULL)
+    {
+        memcpy(image.bits(), pixels, 4 * m_width * m_height);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    if (pixels == NULL)
+    {
+        cerr << "Could not map the pixels of " << slot.filename << endl;
+        m_numFailed++;
+        return;
+    }
+
+    // Waits here only if the encoders have fallen far behind.
+    m_encoderSlots.acquire();
+    ImageEncoder *encoder = new ImageEncoder(image, slot.filename, &m_encoderSlots, &m_numFailed);
+    image = QImage(); // Leave the encoder the only reference, so flipping does not copy.
+    m_encoders.start(encoder);
+}
+
+int AsyncReadback::finish()
+{
+    for (unsigned int i = 0; i < m_slots.size(); i++)
+        _collect(m_slots[(m_nextSlot + i) % m_slots.size()]);
+    m_encoders.waitForDone();
+
+    return m_numFailed.exchange(0);
+}
@@ -0,0 +1,57 @@
+#ifndef ASYNCREADBACK_H
+#define ASYNCREADBACK_H
+
+#include "hairCommon.h"
+#include <QThreadPool>
+#include <QSemaphore>
+#include <atomic>
+#include <string>
+
+class Framebuffer;
+
+/**
+ * Saves rendered frames without stalling the render loop. read() only queues
+ * a copy of the framebuffer into one of a ring of pixel buffer objects; the
+ * pixels are fetched the next time that buffer comes around, by which point
+ * the GPU has long finished, so the following frames render while earlier
+ * ones are still being copied. Flipping the rows and encoding the file
+ * (PNG, JPEG or anything else QImage writes, plus EXR) runs on a pool of
+ * encoder threads.
+ *
+ * All methods need the GL context current that the buffers were created in.
+ */
+class AsyncReadback
+{
+public:
+    AsyncReadback(int width, int height, int numBuffers = 2);
+    virtual ~AsyncReadback();
+
+    // Starts reading the first color attachment of source; the image is
+    // written to filename in the background.
+    void read(Framebuffer *source, const std::string &filename);
+
+    // Waits until every frame read so far is written. Returns the number of
+    // frames that could not be written since the last call.
+    int finish();
+
+private:
+    struct Slot
+    {
+        GLuint buffer;
+        GLsync fence;
+        std::string filename;
+    };
+
+    // Hands the frame in slot to an encoder once the GPU has written it.
+    void _collect(Slot &slot);
+
+    int m_width, m_height;
+    std::vector<Slot> m_slots;
+    int m_nextSlot;
+
+    QThreadPool m_encoders;
+    QSemaphore m_encoderSlots; // Bounds the number of frames waiting to be encoded.
+    std::atomic<int> m_numFailed;
+};
+
+#endif // ASYNCREADBACK_H
@@ -0,0 +1,177 @@
+#include "batchrenderer.h"
+#include "renderer.h"
+#include "hairobject.h"
+#include "offscreencontext.h"
+#include "errorchecker.h"
+#include "asyncreadback.h"
+#include "simulationcache.h"
+
+#include <QFile>
+#include <QTextStream>
+#include <QStringList>
+
+BatchRenderer::BatchRenderer(int width, int height)
+    : m_width(width),
+      m_height(height)
+{
+    m_context = NULL;
+    m_renderer = NULL;
+    m_readback = NULL;
+
+    // Same framing as GLWidget::initCamera().
+    float zoom = 0.7;
+    m_view = glm::translate(glm::vec3(0, 0, -zoom)) *
+            glm::translate(glm::mat4(1.0f), glm::vec3(0.0006 ,   -1.7158 ,   -0.0456));
+    m_projection = glm::perspective(0.8f, (float)m_width/m_height, 0.1f, 100.0f);
+}
+
+BatchRenderer::~BatchRenderer()
+{
+    // GL objects have to be released while the context is current.
+    if (m_context != NULL)
+        m_context->makeCurrent();
+    safeDelete(m_readback);
+    safeDelete(m_renderer);
+    safeDelete(m_context);
+}
+
+bool BatchRenderer::readJobFile(const char *filename, QList<RenderJob> &jobs)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        cerr << "Could not open job file " << filename << endl;
+        return false;
+    }
+
+    QTextStream in(&file);
+    int lineNumber = 0;
+    while (!in.atEnd())
+    {
+        QString line = in.readLine().trimmed();
+        lineNumber++;
+        if (line.isEmpty() || line.startsWith("#"))
+            continue;
+
+        QStringList fields = line.split(" ", QString::SkipEmptyParts);
+        if (fields.size() < 6 || fields.size() > 8)
+        {
+            cerr << filename << ":" << lineNumber << ": expected 6 to 8 fields, found " << fields.size() << endl;
+            return false;
+        }
+
+        RenderJob job;
+        job.hairFile = fields[0].toStdString();
+        job.meshFile = fields[1].toStdString();
+        job.angles = glm::vec3(fields[2].toFloat(), fields[3].toFloat(), fields[4].toFloat()) / 180.f * (float) M_PI;
+        job.outputFile = fields[5].toStdString();
+        job.simulationFrame = -1;
+
+        if (fields.size() == 6)
+        {
+            jobs.append(job);
+            continue;
+        }
+
+        // With a simulation cache, the frames are the first frames of the
+        // cache (0 for all of them) seen from a fixed angle; otherwise they
+        // are a turntable.
+        int numFrames = fields[6].toInt();
+        bool simulated = fields.size() == 8;
+        if (simulated)
+        {
+            SimulationCache cache;
+            if (!cache.open(fields[7].toStdString()))
+                return false;
+            job.simulationCache = fields[7].toStdString();
+            numFrames = numFrames > 0 ? std::min(numFrames, cache.numFrames()) : cache.numFrames();
+        }
+        if (numFrames < 1)
+        {
+            cerr << filename << ":" << lineNumber << ": needs at least one frame" << endl;
+            return false;
+        }
+
+        // Frames share their files, so the scene is loaded once for all of them.
+        QString output = fields[5];
+        int dot = output.lastIndexOf('.');
+        if (dot <= output.lastIndexOf('/'))
+            dot = output.size();
+        for (int frame = 0; frame < numFrames; frame++)
+        {
+            RenderJob frameJob = job;
+            if (simulated)
+                frameJob.simulationFrame = frame;
+            else
+                frameJob.angles.y += 2.f * (float) M_PI * frame / numFrames;
+            frameJob.outputFile = (output.left(dot) + QString("_%1").arg(frame, 4, 10, QChar('0')) + output.mid(dot)).toStdString();
+            jobs.append(frameJob);
+        }
+    }
+    return true;
+}
+
+int BatchRenderer::run(const QList<RenderJob> &jobs)
+{
+    if (!_initContext())
+        return jobs.size();
+
+    int numFailed = 0;
+    for (int i = 0; i < jobs.size(); i++)
+    {
+        cout << "Rendering job " << i + 1 << "/" << jobs.size() << ": " << jobs[i].outputFile << endl;
+        if (!_renderJob(jobs[i]))
+            numFailed++;
+    }
+
+    // Saving errors only show up once the encoders are done.
+    numFailed += m_readback->finish();
+
+    m_context->doneCurrent();
+    if (numFailed > 0)
+        cerr << numFailed << " of " << jobs.size() << " jobs failed." << endl;
+    return numFailed;
+}
+
+bool BatchRenderer::_initContext()
+{
+    m_context = new OffscreenContext();
+    if (!m_context->create(m_width, m_height))
+        return false;
+
+    m_renderer = new Renderer();
+    m_renderer->init(m_width, m_height);
+    m_readback = new AsyncReadback(m_width, m_height);
+    return true;
+}
+
+bool BatchRenderer::_renderJob(const RenderJob &job)
+{
+    // The loaders exit on missing files, so check up front and only fail this job.
+    if (!QFile::exists(job.hairFile.c_str()) || !QFile::exists(job.meshFile.c_str()))
+    {
+        cerr << "Missing input for " << job.outputFile << ": " << job.hairFile << ", " << job.meshFile << endl;
+        return false;
+    }
+
+    m_renderer->loadScene(job.hairFile, job.meshFile);
+    m_renderer->setModelRotation(job.angles);
+
+    // Frames read straight from the mapped cache, without simulating up to
+    // them. Other jobs show the rest pose, even if the hair was posed before.
+    if (job.simulationFrame < 0)
+    {
+        m_renderer->m_hairObject->setGuidePositions(m_renderer->m_hairObject->m_guideHairs.m_startPositions);
+    }
+    else if (!m_renderer->playSimulationCache(job.simulationCache) || !m_renderer->showCachedFrame(job.simulationFrame))
+    {
+        cerr << "Could not pose the hair for " << job.outputFile << endl;
+        return false;
+    }
+
+    m_renderer->render(m_view, m_projection, m_width, m_height, m_context->target);
+    ErrorChecker::printGLErrors("BatchRenderer::_renderJob");
+
+    m_readback->read(m_context->target, job.outputFile);
+    return true;
+}
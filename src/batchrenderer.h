@@ -0,0 +1,67 @@
+#ifndef BATCHRENDERER_H
+#define BATCHRENDERER_H
+
+#include "hairCommon.h"
+#include <QList>
+#include <string>
+
+class Renderer;
+class OffscreenContext;
+class AsyncReadback;
+
+struct RenderJob
+{
+    std::string hairFile;
+    std::string meshFile;
+    glm::vec3 angles;        // Rotation around x, y and z in radians.
+    std::string outputFile;
+
+    // Frame of a simulation cache to pose the hair with, instead of the rest pose.
+    std::string simulationCache;
+    int simulationFrame;
+};
+
+/**
+ * Renders a list of jobs without opening a window or needing a display server
+ * (see OffscreenContext). The GL context, shader programs and framebuffers are
+ * created once, and consecutive jobs that use the same hair/head pair reuse the
+ * loaded assets; only the model rotation changes between them. Images are read
+ * back and written asynchronously (see AsyncReadback), so a job renders while
+ * the previous ones are still being saved.
+ */
+class BatchRenderer
+{
+public:
+    BatchRenderer(int width = 800, int height = 800);
+    virtual ~BatchRenderer();
+
+    /**
+     * Reads a job file with one job per line, in the same order as the command line:
+     *   <hair file> <mesh file> <x angle> <y angle> <z angle> <output image> [<frames> [<simulation cache>]]
+     * Angles are in degrees. With a frame count the line is a turntable: the y
+     * angle goes once around the circle in that many steps, and the frame number
+     * is added to the output name (out.png becomes out_0000.png, out_0001.png, ...).
+     * With a simulation cache as well (see SimulationCache), the angle stays and
+     * the frames pose the hair with the first that many cached frames, or all of
+     * them for 0. Cached frames do not depend on each other, so the frames of one
+     * cache can be split over several job files and rendered in parallel.
+     * Blank lines and lines starting with '#' are ignored.
+     */
+    static bool readJobFile(const char *filename, QList<RenderJob> &jobs);
+
+    // Renders all jobs in order. Returns the number of jobs that failed.
+    int run(const QList<RenderJob> &jobs);
+
+private:
+    bool _initContext();
+    bool _renderJob(const RenderJob &job);
+
+    int m_width, m_height;
+    glm::mat4 m_view, m_projection;
+
+    OffscreenContext *m_context;
+    Renderer *m_renderer;
+    AsyncReadback *m_readback;
+};
+
+#endif // BATCHRENDERER_H
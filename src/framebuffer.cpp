@@ -4,7 +4,8 @@
 
 Framebuffer::~Framebuffer()
 {
-    safeDelete(colorTexture);
+    for (unsigned int i = 0; i < colorTextures.size(); ++i)
+        safeDelete(colorTextures[i]);
     safeDelete(depthTexture);
 }
 
@@ -60,12 +61,30 @@ void Framebuffer::attachDepthTexture(GLuint textureID, GLenum target)
 
 void Framebuffer::generateColorTexture(int width, int height, GLint magFilter, GLint minFilter)
 {
-    safeDelete(colorTexture);
+    for (unsigned int i = 0; i < colorTextures.size(); ++i)
+        safeDelete(colorTextures[i]);
     colorTexture = new Texture();
     colorTexture->createColorTexture(width, height, magFilter, minFilter);
+    colorTextures = {colorTexture};
     attachColorTexture(colorTexture->id);
 }
 
+void Framebuffer::generateFloatColorTextures(int count, int width, int height, GLint magFilter, GLint minFilter)
+{
+    for (unsigned int i = 0; i < colorTextures.size(); ++i)
+        safeDelete(colorTextures[i]);
+    colorTextures.resize(count);
+    std::vector<GLuint> textureIDs(count);
+    for (int i = 0; i < count; ++i)
+    {
+        colorTextures[i] = new Texture();
+        colorTextures[i]->createFloatTexture(width, height, magFilter, minFilter);
+        textureIDs[i] = colorTextures[i]->id;
+    }
+    colorTexture = count > 0 ? colorTextures[0] : NULL;
+    attachColorTextures(textureIDs);
+}
+
 void Framebuffer::generateDepthTexture(int width, int height, GLint magFilter, GLint minFilter)
 {
     safeDelete(depthTexture);
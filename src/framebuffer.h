@@ -24,6 +24,10 @@ public:
 
     void generateColorTexture(int width, int height, GLint magFilter, GLint minFilter);
 
+    // Creates count floating point color textures, attached in order so a
+    // shader can write to all of them at once. The first is colorTexture.
+    void generateFloatColorTextures(int count, int width, int height, GLint magFilter, GLint minFilter);
+
     void generateDepthTexture(int width, int height, GLint magFilter, GLint minFilter);
 
     void generateDepthBuffer(int width, int height);
@@ -31,6 +35,7 @@ public:
     void resizeDepthBuffer(int width, int height);
 
     Texture *colorTexture = NULL;
+    std::vector<Texture*> colorTextures; // Every color attachment, starting with colorTexture.
     Texture *depthTexture = NULL;
 
 private:
@@ -8,34 +8,25 @@
 
 #include "hairobject.h"
 #include "simulation.h"
-#include "hairshaderprogram.h"
-#include "meshshaderprogram.h"
-#include "hairopacityshaderprogram.h"
-#include "whitehairshaderprogram.h"
-#include "whitemeshshaderprogram.h"
-#include "hairdepthpeelprogram.h"
-#include "meshdepthpeelprogram.h"
+#include "objmesh.h"
 #include "hairinterface.h"
-#include "meshocttree.h"
 #include "texture.h"
-#include "framebuffer.h"
-#include "tessellator.h"
-#include "hairrendershaderprogram.h"
+#include "renderer.h"
 
 #include "sceneeditor.h"
 
-#include <glm/gtx/color_space.hpp>
-
 #define SHIFT_CLICK true
 
-#define FEEDBACK false
-
 extern std::string hairstyle_file;
 extern std::string headmodel_file;
 extern float X_angle;
 extern float Y_angle;
 extern float Z_angle;
-extern std::string save_image;
+extern bool deterministic_mode;
+extern std::string state_dump_file;
+extern std::string bake_file;
+extern std::string playback_file;
+
 GLWidget::GLWidget(QGLFormat format, HairInterface *hairInterface, QWidget *parent)
     : QGLWidget(format, parent),
       m_hairInterface(hairInterface),
@@ -45,45 +36,12 @@ GLWidget::GLWidget(QGLFormat format, HairInterface *hairInterface, QWidget *pare
       m_increment(0),
       m_targetFPS(60.f)
 {
-    m_highResMesh = NULL;
-    m_lowResMesh = NULL;
-    m_hairObject = NULL;
-    m_testSimulation = NULL;
     m_sceneEditor = NULL;
 
     resetFromSceneEditorGrowthTexture = NULL;
     resetFromSceneEditorGroomingTexture = NULL;
 
-    m_noiseTexture = new Texture();
-
-    // Shader programs
-    m_programs = {
-        m_hairProgram = new HairShaderProgram(),
-        m_meshProgram = new MeshShaderProgram(),
-        m_hairOpacityProgram = new HairOpacityShaderProgram(),
-        m_whiteHairProgram = new WhiteHairShaderProgram(),
-        m_whiteMeshProgram = new WhiteMeshShaderProgram(),
-        m_hairDepthPeelProgram = new HairDepthPeelShaderProgram(),
-        m_meshDepthPeelProgram = new MeshDepthPeelShaderProgram(),
-
-        // TRANSFORM FEEDBACK
-        m_TFhairProgram = new HairRenderShaderProgram(),
-        m_TFwhiteHairProgram = new WhiteHairFeedbackShaderProgram(),
-        m_TFhairDepthPeelProgram = new HairFeedbackDepthPeelShaderProgram(),
-        m_TFhairOpacityProgram = new HairFeedbackOpacityShaderProgram(),
-    };
-
-    // Framebuffers
-    m_framebuffers = {
-        m_hairShadowFramebuffer = new Framebuffer(),
-        m_meshShadowFramebuffer = new Framebuffer(),
-        m_opacityMapFramebuffer = new Framebuffer(),
-        m_finalFramebuffer = new Framebuffer(),
-        m_depthPeel0Framebuffer = new Framebuffer(),
-        m_depthPeel1Framebuffer = new Framebuffer(),
-    };
-
-    m_tessellator = new Tessellator();
+    m_renderer = new Renderer();
 
     m_hairInterface->setGLWidget(this);
 
@@ -95,48 +53,13 @@ GLWidget::GLWidget(QGLFormat format, HairInterface *hairInterface, QWidget *pare
 
 GLWidget::~GLWidget()
 {
-    for (auto program = m_programs.begin(); program != m_programs.end(); ++program)
-        safeDelete(*program);
-    for (auto framebuffer = m_framebuffers.begin(); framebuffer != m_framebuffers.end(); ++framebuffer)
-        safeDelete(*framebuffer);
-
-    safeDelete(m_noiseTexture);
-    safeDelete(m_highResMesh);
-    safeDelete(m_lowResMesh);
-    safeDelete(m_testSimulation);
-    safeDelete(m_hairObject);
+    safeDelete(m_renderer);
 }
 
 void GLWidget::initializeGL()
 {
     ResourceLoader::initializeGlew();
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_CULL_FACE);
-    glClearColor(0.5f, 0.5f, 0.5f, 0.0f);
-    //glClearColor(1.0f, 1.0f, 1.0f, 0.0f);
-
-    // Initialize shader programs.
-    for (auto program = m_programs.begin(); program != m_programs.end(); ++program)
-        (*program)->create();
-
-    // Initialize textures.
-    m_noiseTexture->createColorTexture(":/images/noise128.jpg", GL_LINEAR, GL_LINEAR);
-
-    // Initialize framebuffers.
-    int shadowMapRes = 4096;
-    glm::vec2 finalSize = glm::vec2(2 * width(), 2 * height());
-    for (auto framebuffer = m_framebuffers.begin(); framebuffer != m_framebuffers.end(); ++framebuffer)
-        (*framebuffer)->create();
-    m_hairShadowFramebuffer->generateDepthTexture(shadowMapRes, shadowMapRes, GL_NEAREST, GL_NEAREST);
-    m_meshShadowFramebuffer->generateDepthTexture(shadowMapRes, shadowMapRes, GL_LINEAR, GL_LINEAR);
-    m_opacityMapFramebuffer->generateColorTexture(shadowMapRes, shadowMapRes, GL_NEAREST, GL_NEAREST);
-    m_opacityMapFramebuffer->generateDepthBuffer(shadowMapRes, shadowMapRes);
-    m_finalFramebuffer->generateColorTexture(finalSize.x, finalSize.y, GL_LINEAR, GL_LINEAR);
-    m_finalFramebuffer->generateDepthBuffer(finalSize.x, finalSize.y);
-    m_depthPeel0Framebuffer->generateColorTexture(finalSize.x, finalSize.y, GL_LINEAR, GL_LINEAR);
-    m_depthPeel0Framebuffer->generateDepthTexture(finalSize.x, finalSize.y, GL_NEAREST, GL_NEAREST);
-    m_depthPeel1Framebuffer->generateColorTexture(finalSize.x, finalSize.y, GL_LINEAR, GL_LINEAR);
-    m_depthPeel1Framebuffer->generateDepthBuffer(finalSize.x, finalSize.y);
+    m_renderer->init(width(), height());
 
     // Initialize simulation.
     initSimulation();
@@ -156,193 +79,17 @@ void GLWidget::paintGL()
         resetFromSceneEditorGrowthTexture = NULL;
     }
 
-    m_clock.restart();
-
-    _resizeDepthPeelFramebuffers();
+    float frameTime = m_clock.restart() / 1000.f;
 
     // Update simulation if not paused.
     if (!isPaused())
     {
         m_increment++;
         float time = m_increment / (float) m_targetFPS; // Time in seconds (assuming 60 FPS).
-        m_testSimulation->update(time);
-        m_hairObject->update(time);
-    }
-
-    // Update transformation matrices.
-    glm::mat4 model = glm::mat4(1.f);
-    model = m_testSimulation->m_xform;
-    //m_lightPosition = glm::vec3(2.0, 2.0, 2.0);
-    //cout<<"set m_lightposition"<<endl;
-    //m_lightPosition = glm::vec3(0.5, 1.5, 2);
-    glm::mat4 lightProjection = glm::perspective(1.3f, 1.f, .1f, 100.f);
-    glm::mat4 lightView = glm::lookAt(m_lightPosition, glm::vec3(0), glm::vec3(0,1,0));
-    m_eyeToLight = lightProjection * lightView * glm::inverse(m_view);
-
-    // Bind textures.
-    m_noiseTexture->bind(GL_TEXTURE0);
-    m_hairShadowFramebuffer->depthTexture->bind(GL_TEXTURE1);
-    m_opacityMapFramebuffer->colorTexture->bind(GL_TEXTURE2);
-    m_meshShadowFramebuffer->depthTexture->bind(GL_TEXTURE3);
-    m_finalFramebuffer->colorTexture->bind(GL_TEXTURE4);
-    m_hairObject->m_blurredHairGrowthMapTexture->bind(GL_TEXTURE5);
-    m_depthPeel0Framebuffer->depthTexture->bind(GL_TEXTURE6);
-    m_depthPeel0Framebuffer->colorTexture->bind(GL_TEXTURE7);
-    m_depthPeel1Framebuffer->colorTexture->bind(GL_TEXTURE8);
-
-#if FEEDBACK
-    int numTriangles =
-            m_hairObject->m_guideHairs.size()       // # guide hairs
-            * m_hairObject->m_numGroupHairs         // # hairs per guide hair
-            * (m_hairObject->m_numSplineVertices-1) // # segments per hair
-            * 2;                                    // # triangles per segment
-    m_tessellator->setNumTriangles(numTriangles);
-
-    m_tessellator->beginTessellation();
-    _drawHair(m_tessellator->program, model, m_view, m_projection, false);
-    m_tessellator->endTessellation();
-#endif
-
-    if (useShadows)
-    {
-        // Render hair shadow map.
-        m_hairShadowFramebuffer->bind();
-        glViewport(0, 0, m_hairShadowFramebuffer->depthTexture->width(), m_hairShadowFramebuffer->depthTexture->height());
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-#if FEEDBACK
-        _drawHairFromFeedback(m_TFwhiteHairProgram, model, lightView, lightProjection);
-#else
-        _drawHair(m_whiteHairProgram, model, lightView, lightProjection);
-#endif
-
-        // Render mesh shadow map.
-        m_meshShadowFramebuffer->bind();
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        //_drawMesh(m_whiteMeshProgram, model, lightView, lightProjection);
-
-        // Enable additive blending for opacity map.
-        glDisable(GL_DEPTH_TEST);
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_ONE, GL_ONE);
-        glBlendEquation(GL_FUNC_ADD);
-
-        // Render opacity map.
-        m_opacityMapFramebuffer->bind();
-        glViewport(0, 0, m_hairShadowFramebuffer->depthTexture->width(), m_hairShadowFramebuffer->depthTexture->height());
-        glClearColor(0.f, 0.f, 0.f, 0.f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-#if FEEDBACK
-        _drawHairFromFeedback(m_TFhairOpacityProgram, model, lightView, lightProjection);
-#else
-        _drawHair(m_hairOpacityProgram, model, lightView, lightProjection);
-#endif
-
-        // Restore previous state.
-        m_opacityMapFramebuffer->unbind();
-        glEnable(GL_DEPTH_TEST);
-        glDisable(GL_BLEND);
-
-    }
-
-    if (useTransparency)
-    {
-        glViewport(0, 0, m_depthPeel0Framebuffer->colorTexture->width(), m_depthPeel0Framebuffer->colorTexture->height());
-        glClearColor(1.0f, 1.0f, 1.0f, 0.0f);    //draw background
-
-        // Draw first (front-most) depth peeling layer.
-        m_depthPeel0Framebuffer->bind();
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-#if FEEDBACK
-        _drawHairFromFeedback(m_TFhairProgram, model, m_view, m_projection);
-#else
-        _drawHair(m_hairProgram, model, m_view, m_projection);
-#endif
-        _drawMesh(m_meshProgram, model, m_view, m_projection);
-
-        // Draw second depth peeling layer.
-        m_depthPeel1Framebuffer->bind();
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-#if FEEDBACK
-        _drawHairFromFeedback(m_TFhairDepthPeelProgram, model, m_view, m_projection);
-#else
-        _drawHair(m_hairDepthPeelProgram, model, m_view, m_projection);
-#endif
-        _drawMesh(m_meshDepthPeelProgram, model, m_view, m_projection);
-
-        // Render farthest layer to screen.
-        m_depthPeel1Framebuffer->unbind();
-        glViewport(0, 0, width(), height());
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glDisable(GL_DEPTH_TEST);
-        m_depthPeel1Framebuffer->colorTexture->renderFullScreen();
-
-        // Blend closer layers on top.
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        m_depthPeel0Framebuffer->colorTexture->renderFullScreen();
-        glDisable(GL_BLEND);
-        glEnable(GL_DEPTH_TEST);
-    }
-
-    else
-    {
-        if (useSupersampling)
-        {
-            // Render into supersample framebuffer.
-            m_finalFramebuffer->bind();
-            glViewport(0, 0, m_finalFramebuffer->colorTexture->width(), m_finalFramebuffer->colorTexture->height());
-        }
-        else
-        {
-            // Render into default framebuffer...
-            glViewport(0, 0, width(), height());
-        }
-
-        // Render scene.
-        glClearColor(1.0f, 1.0f, 1.0f, 0.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-#if FEEDBACK
-        _drawHairFromFeedback(m_TFhairProgram, model, m_view, m_projection);
-#else
-        _drawHair(m_hairProgram, model, m_view, m_projection);
-#endif
-        _drawMesh(m_meshProgram, model, m_view, m_projection);
-
-        if (useSupersampling)
-        {
-            // Render supersampled texture.
-            m_finalFramebuffer->unbind();
-            glViewport(0, 0, width(), height());
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-            m_finalFramebuffer->colorTexture->renderFullScreen();
-        }
+        m_renderer->update(time, frameTime);
     }
 
-    // Clean up.
-    m_noiseTexture->unbind(GL_TEXTURE0);
-    m_hairShadowFramebuffer->depthTexture->unbind(GL_TEXTURE1);
-    m_opacityMapFramebuffer->colorTexture->unbind(GL_TEXTURE2);
-    m_meshShadowFramebuffer->depthTexture->unbind(GL_TEXTURE3);
-    m_finalFramebuffer->colorTexture->unbind(GL_TEXTURE4);
-    m_hairObject->m_blurredHairGrowthMapTexture->unbind(GL_TEXTURE5);
-    m_depthPeel0Framebuffer->depthTexture->bind(GL_TEXTURE6);
-    m_depthPeel0Framebuffer->colorTexture->bind(GL_TEXTURE7);
-    m_depthPeel1Framebuffer->colorTexture->bind(GL_TEXTURE8);
-
-    if(save_image.size()>0){
-        int screenStats[4];
-        glGetIntegerv(GL_VIEWPORT,screenStats);
-        //cout<<"screenStats"<<screenStats[0]<<","<<screenStats[1]<<","<<screenStats[2]<<","<<screenStats[3]<<endl;
-        uchar * imageData = new unsigned char[(screenStats[2])*(screenStats[3])*3];
-        glReadPixels(0,0,screenStats[2]-1, screenStats[3]-1,GL_RGB,GL_UNSIGNED_BYTE,imageData);
-        QImage saveImage(imageData,screenStats[2]-1,screenStats[3]-1,QImage::Format_RGB888);
-        QImage flipped = saveImage.mirrored(false,true);
-        flipped.save(save_image.c_str());
-        exit(1);
-    }
+    m_renderer->render(m_view, m_projection, width(), height());
 
     // Update UI.
     m_hairInterface->updateFPSLabel(m_increment);
@@ -358,154 +105,23 @@ void GLWidget::resizeGL(int w, int h)
     glViewport(0, 0, w, h);
     m_projection = glm::perspective(0.8f, (float)width()/height(), 0.1f, 100.f);
 
-    m_finalFramebuffer->colorTexture->resize(2*w, 2*h);
-    m_finalFramebuffer->resizeDepthBuffer(2*w, 2*h);
-
     forceUpdate();
 }
 
-void GLWidget::_resizeDepthPeelFramebuffers()
-{
-    int w = useSupersampling ? 2 * width() : width();
-    int h = useSupersampling ? 2 * height() : height();
-
-    Texture *colorTexture0 = m_depthPeel0Framebuffer->colorTexture;
-    if (colorTexture0->width() != w || colorTexture0->height() != h)
-    {
-        m_depthPeel0Framebuffer->colorTexture->resize(w, h);
-        m_depthPeel0Framebuffer->depthTexture->resize(w, h);
-        m_depthPeel1Framebuffer->colorTexture->resize(w, h);
-        m_depthPeel1Framebuffer->resizeDepthBuffer(w, h);
-    }
-}
-
-void GLWidget::_drawHair(ShaderProgram *program, glm::mat4 model, glm::mat4 view, glm::mat4 projection, bool bindProgram)
-{
-    if (bindProgram)
-    {
-        program->bind();
-    }
-    program->uniforms.noiseTexture = 0;
-    program->uniforms.hairShadowMap = 1;
-    program->uniforms.opacityMap = 2;
-    program->uniforms.meshShadowMap = 3;
-    program->uniforms.depthPeelMap = 6;
-    program->uniforms.projection = projection;
-    program->uniforms.view = view;
-    program->uniforms.model = model;
-    program->uniforms.eyeToLight = m_eyeToLight;
-    program->uniforms.lightPosition = m_lightPosition;
-    program->uniforms.shadowIntensity = m_hairObject->m_shadowIntensity;
-    program->uniforms.useShadows = useShadows;
-    program->uniforms.specIntensity = m_hairObject->m_specularIntensity;
-    program->uniforms.diffuseIntensity = m_hairObject->m_diffuseIntensity;
-    program->uniforms.opacity = 1.f - m_hairObject->m_transparency;
-    if (m_hairObject->m_useHairColorVariation){
-        program->uniforms.maxColorVariation = m_hairObject->m_hairColorVariation;
-    } else {
-        program->uniforms.maxColorVariation = 0;
-    }
-    //program->setPerDrawUniforms();
-    program->setGlobalUniforms();
-    m_hairObject->paint(program);
-}
-
-void GLWidget::_drawHairFromFeedback(ShaderProgram *program, glm::mat4 model, glm::mat4 view, glm::mat4 projection)
-{
-    program->bind();
-    program->uniforms.noiseTexture = 0;
-    program->uniforms.hairShadowMap = 1;
-    program->uniforms.opacityMap = 2;
-    program->uniforms.meshShadowMap = 3;
-    program->uniforms.depthPeelMap = 6;
-    program->uniforms.projection = projection;
-    program->uniforms.view = view;
-    program->uniforms.model = model;
-    program->uniforms.eyeToLight = m_eyeToLight;
-    program->uniforms.lightPosition = m_lightPosition;
-    program->uniforms.shadowIntensity = m_hairObject->m_shadowIntensity;
-    program->uniforms.useShadows = useShadows;
-    program->uniforms.specIntensity = m_hairObject->m_specularIntensity;
-    program->uniforms.diffuseIntensity = m_hairObject->m_diffuseIntensity;
-    program->uniforms.opacity = 1.f - m_hairObject->m_transparency;
-    program->uniforms.hairRadius = m_hairObject->m_hairRadius;
-    if (m_hairObject->m_useHairColorVariation){
-        program->uniforms.maxColorVariation = m_hairObject->m_hairColorVariation;
-    } else {
-        program->uniforms.maxColorVariation = 0;
-    }
-    program->uniforms.color = glm::rgbColor(
-                glm::vec3(m_hairObject->m_color.x*255, m_hairObject->m_color.y, m_hairObject->m_color.z));
-
-    program->setGlobalUniforms();
-    program->setPerObjectUniforms();
-    program->setPerDrawUniforms();
-    m_tessellator->draw();
-}
-
-void GLWidget::_drawMesh(ShaderProgram *program, glm::mat4 model, glm::mat4 view, glm::mat4 projection)
-{
-    program->bind();
-    program->uniforms.hairShadowMap = 1;
-    program->uniforms.opacityMap = 2;
-    program->uniforms.meshShadowMap = 3;
-    program->uniforms.hairGrowthMap = 5;
-    program->uniforms.projection = projection;
-    program->uniforms.view = view;
-    program->uniforms.model = model;
-    program->uniforms.lightPosition = m_lightPosition;
-    program->uniforms.eyeToLight = m_eyeToLight;
-    program->uniforms.shadowIntensity = m_hairObject->m_shadowIntensity;
-    program->uniforms.useShadows = useShadows;
-    program->uniforms.color = 2.f * glm::rgbColor(glm::vec3(m_hairObject->m_color.x*255, m_hairObject->m_color.y, m_hairObject->m_color.z)); // multiplying by 2 because it looks better...
-    program->setGlobalUniforms();
-    program->setPerObjectUniforms();
-    m_highResMesh->draw();
-}
-
 void GLWidget::initSimulation()
 {
-    safeDelete(m_highResMesh);
-    safeDelete(m_lowResMesh);
-    HairObject *_oldHairObject = m_hairObject;
-
-    m_highResMesh = new ObjMesh();
-    //m_highResMesh->init(":/models/head.obj");
-    m_highResMesh->init(headmodel_file.c_str()); //load head model
-    cout<<"load obj done."<<endl;
-    m_hairInterface->setMesh(m_highResMesh);
-
-    m_lowResMesh = new ObjMesh();
-    m_lowResMesh->init(headmodel_file.c_str(), 1.1);
-
-    Simulation *_oldSim = m_testSimulation;
-    m_testSimulation = new Simulation(this, m_lowResMesh, _oldSim);
-
-    if (_oldHairObject == NULL){
-        QImage initialGrowthMap(":/images/headHair.jpg");
-        QImage initialGroomingMap(initialGrowthMap.width(), initialGrowthMap.height(), initialGrowthMap.format());
-        initialGroomingMap.fill(QColor(128, 128, 255));
-        //m_hairObject = new HairObject(m_highResMesh, m_hairDensity, m_maxHairLength, initialGrowthMap, initialGroomingMap, m_testSimulation, _oldHairObject);
-        m_hairObject = new HairObject(hairstyle_file.c_str(), initialGrowthMap, initialGroomingMap, m_testSimulation, _oldHairObject);
-    } else {
-        //m_hairObject = new HairObject(m_highResMesh, m_hairDensity, m_maxHairLength, _oldHairObject->m_hairGrowthMap, _oldHairObject->m_hairGroomingMap, m_testSimulation, _oldHairObject);
-        m_hairObject = new HairObject(hairstyle_file.c_str(), _oldHairObject->m_hairGrowthMap, _oldHairObject->m_hairGroomingMap, m_testSimulation, _oldHairObject);
-    }
-
-    safeDelete(_oldSim);
-    safeDelete(_oldHairObject);
-
-    safeDelete(m_tessellator);
-    m_tessellator = new Tessellator();
-    int numTriangles =
-            m_hairObject->m_guideHairs.size()       // # guide hairs
-            * m_hairObject->m_numGroupHairs         // # hairs per guide hair
-            * (m_hairObject->m_numSplineVertices-1) // # segments per hair
-            * 2;                                    // # triangles per segment
-    m_tessellator->init(numTriangles);
-
-    m_hairInterface->setHairObject(m_hairObject);
-
+    // The head mesh is kept if it is already loaded; the hair always restarts from its rest pose.
+    m_renderer->loadScene(hairstyle_file, headmodel_file, true);
+    m_renderer->setModelRotation(glm::vec3(X_angle, Y_angle, Z_angle));
+    m_renderer->m_testSimulation->m_deterministic = deterministic_mode;
+    if (!state_dump_file.empty())
+        m_renderer->m_testSimulation->dumpStates(state_dump_file);
+    if (!bake_file.empty())
+        m_renderer->m_testSimulation->recordCache(m_renderer->m_hairObject, bake_file);
+    if (!playback_file.empty())
+        m_renderer->playSimulationCache(playback_file);
+    m_hairInterface->setMesh(m_renderer->m_highResMesh);
+    m_hairInterface->setHairObject(m_renderer->m_hairObject);
 }
 
 void GLWidget::initCamera(){
@@ -531,21 +147,20 @@ void GLWidget::initCamera(){
 
     m_projection = glm::perspective(0.8f, (float)width()/height(), 0.1f, 100.0f);
 
-   // m_lightPosition = glm::vec3(0.0,2.7,2.0);
-    m_lightPosition = glm::vec3(0.0,2.3,2.0);
+   // m_renderer->m_lightPosition = glm::vec3(0.0,2.7,2.0);
+    m_renderer->m_lightPosition = glm::vec3(0.0,2.3,2.0);
     cout<<"initial"<<endl;
 }
 
 void GLWidget::applySceneEditor(Texture *_hairGrowthTexture, Texture *_hairGroomingTexture){
 
-    HairObject *_oldHairObject = m_hairObject;
+    HairObject *hairObject = new HairObject(
+                m_renderer->m_highResMesh, m_hairDensity, m_maxHairLength, _hairGrowthTexture->m_image, _hairGroomingTexture->m_image,
+                m_renderer->m_testSimulation, m_renderer->m_hairObject);
 
-    m_hairObject = new HairObject(
-                m_highResMesh, m_hairDensity, m_maxHairLength, _hairGrowthTexture->m_image, _hairGroomingTexture->m_image, m_testSimulation, _oldHairObject);
+    m_renderer->setHairObject(hairObject);
 
-    safeDelete(_oldHairObject);
-
-    m_hairInterface->setHairObject(m_hairObject);
+    m_hairInterface->setHairObject(hairObject);
 
 }
 
@@ -555,16 +170,17 @@ void GLWidget::resetSimulation(bool hardReset)
     Simulation *oldSim = NULL;
     HairObject *oldHairObject = NULL;
     if (hardReset){
-        oldSim = m_testSimulation;
-        oldHairObject = m_hairObject;
-        m_testSimulation = NULL;
-        m_hairObject = NULL;
+        oldSim = m_renderer->m_testSimulation;
+        oldHairObject = m_renderer->m_hairObject;
+        m_renderer->m_testSimulation = NULL;
+        m_renderer->m_hairObject = NULL;
     }
     initSimulation();
     initCamera();
 
-    delete oldHairObject;
+    // The simulation may still be stepping the old hair on its thread.
     delete oldSim;
+    delete oldHairObject;
 }
 
 /** Repaints the canvas. Called 60 times per second. */
@@ -582,12 +198,12 @@ void GLWidget::mousePressEvent(QMouseEvent *event)
     if (event->button() == Qt::LeftButton)
     {
         m_prevXformPos = event->pos();
-        m_testSimulation->m_headMoving = true;
+        m_renderer->m_testSimulation->m_headMoving = true;
     }
     if (event->button() == Qt::MiddleButton)
     {
         m_prevRotPos = event->pos();
-        m_testSimulation->m_headMoving = true;
+        m_renderer->m_testSimulation->m_headMoving = true;
     }
 }
 
@@ -612,9 +228,9 @@ void GLWidget::mouseMoveEvent(QMouseEvent *event)
     if (event->buttons() == Qt::LeftButton)
     {
 #endif
-        m_lightPosition.x +=  (event->x() - m_prevMousePos.x()) / (float) width();
-        m_lightPosition.y +=  (event->y() - m_prevMousePos.y()) / (float) height();
-        cout<<m_lightPosition.x<<","<<m_lightPosition.y<<","<<m_lightPosition.z<<endl;
+        m_renderer->m_lightPosition.x +=  (event->x() - m_prevMousePos.x()) / (float) width();
+        m_renderer->m_lightPosition.y +=  (event->y() - m_prevMousePos.y()) / (float) height();
+        cout<<m_renderer->m_lightPosition.x<<","<<m_renderer->m_lightPosition.y<<","<<m_renderer->m_lightPosition.z<<endl;
         // Adjust for USC dataset
 
         m_prevMousePos = event->pos();
@@ -629,7 +245,7 @@ void GLWidget::mouseMoveEvent(QMouseEvent *event)
         xform += (float) delta.x() * 0.005f * right;
         xform += (float) -delta.y() * 0.005f * up;
         if (look.z < 0.0) xform = -xform;
-        m_testSimulation->updatePosition(m_hairObject, xform);
+        m_renderer->m_testSimulation->updatePosition(m_renderer->m_hairObject, xform);
         m_prevXformPos = event->pos();*/
     }
 
@@ -649,13 +265,13 @@ void GLWidget::mouseMoveEvent(QMouseEvent *event)
 
         float angle = 5 * glm::length(p1 - p0);
 
-        glm::mat4 clipToObject = glm::inverse(m_projection * m_view * m_testSimulation->m_xform);
+        glm::mat4 clipToObject = glm::inverse(m_projection * m_view * m_renderer->m_testSimulation->m_xform);
         p0 = glm::vec3(glm::normalize( clipToObject * glm::vec4(p0, 0.f) ));
         p1 = glm::vec3(glm::normalize( clipToObject * glm::vec4(p1, 0.f) ));
 
         glm::vec3 axis = glm::cross(p0, p1);
 
-        m_testSimulation->updateRotation(m_hairObject, angle, axis);
+        m_renderer->m_testSimulation->updateRotation(m_renderer->m_hairObject, angle, axis);
 
         m_prevRotPos = event->pos();
 
@@ -665,7 +281,7 @@ void GLWidget::mouseMoveEvent(QMouseEvent *event)
         //            // Rotate in up
         //            glm::vec3 up = glm::normalize(glm::vec3(m_view[2][1], m_view[2][2], m_view[2][3]));
         //            float angle = delta.x() * 0.001f;
-        //            m_testSimulation->updateRotation(m_hairObject, angle, glm::vec3(0, 1, 0));
+        //            m_renderer->m_testSimulation->updateRotation(m_renderer->m_hairObject, angle, glm::vec3(0, 1, 0));
         //        }
         //        else
         //        {
@@ -675,7 +291,7 @@ void GLWidget::mouseMoveEvent(QMouseEvent *event)
         ////            glm::vec3 look = glm::normalize(glm::vec3(inverseView * glm::vec4(0, 0, 0, 1)));
         ////            glm::vec3 right = glm::cross(up, look);
         //            float angle = delta.y() * 0.001f;
-        //            m_testSimulation->updateRotation(m_hairObject, angle, glm::vec3(1,0,0));
+        //            m_renderer->m_testSimulation->updateRotation(m_renderer->m_hairObject, angle, glm::vec3(1,0,0));
         //        }
     }
 
@@ -684,7 +300,7 @@ void GLWidget::mouseMoveEvent(QMouseEvent *event)
 
 void GLWidget::mouseReleaseEvent(QMouseEvent *event)
 {
-    m_testSimulation->m_headMoving = false;
+    m_renderer->m_testSimulation->m_headMoving = false;
 }
 
 void GLWidget::wheelEvent(QWheelEvent *event)
@@ -6,15 +6,10 @@
 #include <QTime>
 #include "hairCommon.h"
 
-class ObjMesh;
-class HairObject;
-class Simulation;
-class ShaderProgram;
 class HairInterface;
 class Texture;
-class Framebuffer;
 class SceneEditor;
-class Tessellator;
+class Renderer;
 
 class GLWidget : public QGLWidget
 {
@@ -35,10 +30,7 @@ public:
     bool isPaused();
     void forceUpdate(); // Redraws the scene if paused.
 
-    bool useShadows = true;
-    bool useSupersampling = true;
-    bool useFrictionSim = true;
-    bool useTransparency = true;
+    Renderer *m_renderer;
 
 protected:
     void initializeGL() override;
@@ -57,13 +49,6 @@ protected slots:
     void updateCanvas();
 
 private:
-    void _drawHair(ShaderProgram *program, glm::mat4 model, glm::mat4 view, glm::mat4 projection, bool bindProgram = true);
-    void _drawMesh(ShaderProgram *program, glm::mat4 model, glm::mat4 view, glm::mat4 projection);
-
-    void _drawHairFromFeedback(ShaderProgram *program, glm::mat4 model, glm::mat4 view, glm::mat4 projection);
-
-    void _resizeDepthPeelFramebuffers();
-
     //bool m_paused = false;   // pause the simulation for USC dataset
     bool m_paused = true;      //
     bool m_pausedLastFrame = true;
@@ -71,37 +56,6 @@ private:
     HairInterface *m_hairInterface;
     SceneEditor *m_sceneEditor;
 
-    ObjMesh *m_highResMesh, *m_lowResMesh;
-    HairObject *m_hairObject;
-    Simulation *m_testSimulation;
-
-    Tessellator *m_tessellator;
-
-    Texture *m_noiseTexture;
-
-    std::vector<ShaderProgram*> m_programs;
-    ShaderProgram *m_hairProgram,
-                  *m_meshProgram,
-                  *m_hairOpacityProgram,
-                  *m_whiteMeshProgram,
-                  *m_whiteHairProgram,
-                  *m_hairDepthPeelProgram,
-                  *m_meshDepthPeelProgram,
-
-                  // TRANSFORM FEEDBACK
-                  *m_TFwhiteHairProgram,
-                  *m_TFhairDepthPeelProgram,
-                  *m_TFhairOpacityProgram,
-                  *m_TFhairProgram;
-
-    std::vector<Framebuffer*> m_framebuffers;
-    Framebuffer *m_hairShadowFramebuffer,
-                *m_meshShadowFramebuffer,
-                *m_opacityMapFramebuffer,
-                *m_finalFramebuffer,
-                *m_depthPeel0Framebuffer,
-                *m_depthPeel1Framebuffer;
-
     // Camera parameters
     glm::mat4 m_projection, m_view;
     float m_zoom, m_angleX, m_angleY;
@@ -109,10 +63,6 @@ private:
     QPoint m_prevXformPos;
     QPoint m_prevRotPos;
 
-    // Light parameters
-    glm::vec3 m_lightPosition;
-    glm::mat4 m_eyeToLight;
-
     float m_hairDensity;
     float m_maxHairLength;
 
@@ -22,6 +22,8 @@
 #include "glm/gtc/type_ptr.hpp"    // glm::value_ptr
 #include "glm/gtc/constants.hpp"
 
+#include "pcgrandom.h"
+
 // glu.h in different location on macs
 #ifdef __APPLE__
 #include <glu.h>
@@ -84,12 +86,12 @@ struct Triangle {
 
     float area() { return glm::length(glm::cross(v3 - v1, v2 - v1)) / 2.f; }
 
-    void randPoint(glm::vec3 &pos, glm::vec2 &uv, glm::vec3 &normal)
+    void randPoint(PcgRandom &random, glm::vec3 &pos, glm::vec2 &uv, glm::vec3 &normal)
     {
-        float t = sqrt(rand() / (float) RAND_MAX);
+        float t = sqrt(random.uniform());
         glm::vec3 randPtBary;
         randPtBary.x = 1 - t;
-        randPtBary.y = rand() / (float) RAND_MAX;
+        randPtBary.y = random.uniform();
         randPtBary.z = 1 - randPtBary.x - randPtBary.y;
         uv = glm::mat3x2(uv1, uv2, uv3) * randPtBary;
         pos = glm::mat3(v1, v2, v3) * randPtBary;
@@ -154,69 +156,6 @@ inline unsigned int htoi(const char s[])
     return val;
 }
 
-
-inline bool operator==(const Triangle& lhs, const Triangle& rhs){
-    if (lhs.v1 != rhs.v1) return false;
-    if (lhs.v2 != rhs.v2) return false;
-    if (lhs.v3 != rhs.v3) return false;
-    return true;
-}
-
-struct HairVertex
-{
-    glm::vec3 position;
-    glm::vec3 tempPos;
-    glm::vec3 velocity;
-    glm::vec3 forces;
-    glm::vec3 correctionVector;
-    glm::vec3 startPosition;
-    glm::vec3 prevPos;
-    glm::vec3 pointVector;
-    glm::vec3 pointColor;
-    double    theta;
-    double    omega;
-    float    segLen;
-    float     mass;
-    float     invMass;
-
-    HairVertex(void)
-    {
-        position = glm::vec3(0.0);
-        velocity = glm::vec3(0.0);
-        prevPos = glm::vec3(0.0);
-        pointColor = glm::vec3(0.0);
-        omega = 0.0;
-        theta = 0.0;
-        segLen = 0.0;
-        tempPos = glm::vec3(0.0);
-        startPosition = glm::vec3(0.0);
-        forces = glm::vec3(0.0);
-        correctionVector = glm::vec3(0.0);
-        mass = 1.0;
-        invMass = 1.0;
-        pointVector = glm::vec3(0.0);
-    }
-
-    HairVertex(glm::vec3 x)
-    {
-        position = x;
-        tempPos = x;
-        startPosition = x;
-        prevPos = x;
-        velocity = glm::vec3(0.0);
-        omega = 0.0;
-        theta = 0.0;
-        segLen = 0.0;
-        forces = glm::vec3(0.0);
-        correctionVector = glm::vec3(0.0);
-        mass = 1.0;
-        invMass = 1.0;
-        pointVector = glm::vec3(0.0);
-
-    }
-};
-
-
 struct Joint
 {
     glm::vec3 position;
@@ -1,21 +1,23 @@
 #include "hairobject.h"
 
-#include "hair.h"
 #include "errorchecker.h"
 #include "simulation.h"
 #include "texture.h"
 #include "blurrer.h"
+#include "strandbuffer.h"
+#include "hairloader.h"
+#include "scenecache.h"
+#include "threadpool.h"
+#include "pcgrandom.h"
 #include "vector"
 #include <glm/gtx/color_space.hpp>
-#include <cyHairFile.h>
 
-extern float X_angle;
-extern float Y_angle;
-extern float Z_angle;
+// Loaded hair styles are simulated through one guide per this many strands.
+#define STRANDS_PER_GUIDE 16
+
 HairObject::~HairObject()
 {
-    for (int i = 0; i < m_guideHairs.size(); ++i)
-        delete m_guideHairs.at(i);
+    safeDelete(m_strandBuffer);
     safeDelete(m_blurredHairGrowthMapTexture);
 }
 
@@ -60,94 +62,6 @@ bool read_bin(const char *filename, std::vector<Strand>& strands)
 	return true;
 }
 
-bool read_cvhair(const char *filename, std::vector<Strand>& strands, std::vector<glm::vec3>& perStrandColor){
-    glm::mat4 transformation = glm::translate(glm::vec3(-0.0006 ,   1.7158 ,   0.0456)) *
-            glm::rotate(X_angle,glm::vec3(1,0,0)) *
-            glm::rotate(Y_angle,glm::vec3(0,1,0)) *
-            glm::rotate(Z_angle,glm::vec3(0,0,1)) *
-            glm::translate(glm::mat4(1.0f),glm::vec3(0.0006 ,   -1.7158 ,   -0.0456));
-    cyHairFile hairfile;
-    hairfile.LoadFromFile(filename);
-    int hairCount = hairfile.GetHeader().hair_count;
-    int pointCount = hairfile.GetHeader().point_count;
-    bool randomcolor = false;
-    strands.clear();
-    strands.resize(hairCount);
-    perStrandColor.clear();
-    perStrandColor.resize(hairCount);
-    double *colorvalue = new double [pointCount*3]();
-    std::string filestring = filename;
-    std::string colorfile = filestring.substr(0,filestring.size()-4)+"bin";
-    FILE *pfile;
-    pfile = fopen(colorfile.c_str(),"rb");
-    int returnvalue = 0;
-    if(pfile!=NULL)
-    {
-        returnvalue = fread(colorvalue,sizeof(double),pointCount *3,pfile);
-        fclose(pfile);
-    }
-
-    if(returnvalue != pointCount *3)
-    {
-        cout<<"no valid color values found from "<<colorfile<<endl;
-        randomcolor = true;
-    }
-    //int pointCount = hairfile.GetHeader().point_count;
-    cout<<"hair count:"<<hairCount<<endl;
-    int pointIndex = 0;
-    int count=0;
-    float* arrays = hairfile.GetPointsArray();
-    unsigned short* segments = hairfile.GetSegmentsArray();
-    //for(int hairIndex=0;hairIndex<hairCount;hairIndex++)
-    //	cout<<segments[hairIndex]<<",";
-    if(segments) {
-        if(randomcolor){
-            for(int hairIndex=0;hairIndex<hairCount;hairIndex++) {
-                float r = ((float) rand()) / (float) RAND_MAX ;
-                float g = ((float) rand()) / (float) RAND_MAX ;
-                float b = ((float) rand()) / (float) RAND_MAX ;
-                perStrandColor[hairIndex] = glm::vec3(r,g,b);
-                for(int j=pointIndex;j<pointIndex+segments[hairIndex]+1;j++) {
-                    float p0[3];
-                    p0[0]=arrays[3*j];
-                    p0[1]=arrays[3*j+1];
-                    p0[2]=arrays[3*j+2];
-                    glm::vec4 temp= transformation *glm::vec4(p0[0],p0[1],p0[2],1.0);
-                //    cout<<p0[0]<<","<<p0[1]<<","<<p0[2]<<","<<temp.x<<","<<temp.y<<","<<temp.z<<endl;
-                    strands[hairIndex].push_back(glm::vec3(temp.x,temp.y,temp.z));
-                    //colors[hairIndex].push_back(glm::vec3(r,g,b));
-                }
-                pointIndex += segments[hairIndex]+1;
-                count+=1;
-            }
-        }
-        else{
-            for(int hairIndex=0;hairIndex<hairCount;hairIndex++) {
-                perStrandColor[hairIndex] = glm::vec3(0.0);
-                for(int j=pointIndex;j<pointIndex+segments[hairIndex]+1;j++) {
-                    float p0[3];
-                    p0[0]=arrays[3*j];
-                    p0[1]=arrays[3*j+1];
-                    p0[2]=arrays[3*j+2];
-                    glm::vec4 temp= transformation *glm::vec4(p0[0],p0[1],p0[2],1.0);
-                //    cout<<p0[0]<<","<<p0[1]<<","<<p0[2]<<","<<temp.x<<","<<temp.y<<","<<temp.z<<endl;
-                    strands[hairIndex].push_back(glm::vec3(temp.x,temp.y,temp.z));
-                    //strands[hairIndex].push_back(glm::vec3(p0[0],p0[1],p0[2]));
-                    perStrandColor[hairIndex] += glm::vec3(colorvalue[3*j],colorvalue[3*j+1],colorvalue[3*j+2]);
-                    //colors[hairIndex].push_back(glm::vec3(colorvalue[3*j],colorvalue[3*j+1],colorvalue[3*j+2]));
-                }
-                perStrandColor[hairIndex] /= segments[hairIndex];
-                perStrandColor[hairIndex] /= 255.0f;
-                pointIndex += segments[hairIndex]+1;
-                count+=1;
-            }
-        }
-        }
-        else
-            cout<<"none hair segs."<<endl;
-    return true;
-}
-
 HairObject::HairObject(
         ObjMesh *mesh,
         float hairsPerUnitArea,
@@ -172,6 +86,7 @@ HairObject::HairObject(
     m_blurredHairGrowthMapTexture = new Texture();
     m_blurredHairGrowthMapTexture->createColorTexture(blurredImage, GL_LINEAR, GL_LINEAR);
 
+    PcgRandom random(RANDOM_STREAM_HAIR_GROWTH);
     int _failures = 0;
     int _emptyPoints = 0;
     for (unsigned int i = 0; i < mesh->triangles.size(); i++)
@@ -179,12 +94,12 @@ HairObject::HairObject(
         Triangle t = mesh->triangles[i];
 
         // Number of guide hairs to generate on this triangle.
-        int numHairs = (int) (hairsPerUnitArea * t.area() + rand() / (float)RAND_MAX);
+        int numHairs = (int) (hairsPerUnitArea * t.area() + random.uniform());
         for (int hair = 0; hair < numHairs; hair++)
         {
             // Generate random point on triangle.
             glm::vec3 pos; glm::vec2 uv; glm::vec3 normal;
-            t.randPoint(pos, uv, normal);
+            t.randPoint(random, pos, uv, normal);
             uv = glm::vec2(MIN(uv.x, 0.999), MIN(uv.y, 0.999)); // Make UV in range [0,1) instead of [0,1]
 
             QPoint p = QPoint(uv.x * hairGrowthMap.width(), (1 - uv.y) * hairGrowthMap.height());
@@ -209,10 +124,17 @@ HairObject::HairObject(
             glm::mat3 m = glm::mat3(u, v, normal);
             glm::vec3 dir = glm::normalize(m * x);
 
-            m_guideHairs.append(new Hair(20, maxHairLength * hairGrowth.valueF(), pos, dir, normal));
+            m_renderHairs.addStrand(20, maxHairLength * hairGrowth.valueF(), pos, dir, normal);
         }
     }
 
+    // Grown hair is already sparse, and the shaders fill it in around each strand.
+    m_skinning.build(m_renderHairs, m_renderHairs.numStrands(), m_guideHairs);
+    m_pool = ThreadPool::shared();
+
+    m_strandBuffer = new StrandBuffer();
+    m_strandBuffer->create(m_renderHairs);
+
     setAttributes(oldObject);
 
     m_simulation = simulation;
@@ -223,27 +145,35 @@ HairObject::HairObject(const char* filename,
         QImage &hairGrowthMap,
         QImage &hairGroomingMap,
         Simulation *simulation,
-        HairObject *oldObject
+        HairObject *oldObject,
+        SceneCache *cache
         ) {
-    std::vector<Strand> strands;
-    //std::vector<Strand> colors;
-    std::vector<glm::vec3> perStrandColor;
-
     m_hairGrowthMap = hairGrowthMap;
     m_hairGroomingMap = hairGroomingMap;
     QImage blurredImage;
-    Blurrer::blur(hairGrowthMap, blurredImage);
+
+    if (cache != NULL)
+    {
+        cache->restoreHair(m_renderHairs, blurredImage);
+    }
+    else
+    {
+        Blurrer::blur(hairGrowthMap, blurredImage);
+
+        //read_bin(filename, strands);
+        if (!HairLoader::loadCyHair(filename, m_renderHairs))
+            cout << "Could not load hair from " << filename << endl;
+    }
+
+    m_skinning.build(m_renderHairs, m_renderHairs.numStrands() / STRANDS_PER_GUIDE, m_guideHairs);
+    m_pool = ThreadPool::shared();
+
     m_blurredHairGrowthMapTexture = new Texture();
     m_blurredHairGrowthMapTexture->createColorTexture(blurredImage, GL_LINEAR, GL_LINEAR);
 
-    //read_bin(filename, strands);
-    read_cvhair(filename,strands,perStrandColor);
-    //cout<<perStrandColor.at(0)[0]<<","<<perStrandColor.at(0)[1]<<","<<perStrandColor.at(0)[2]<<endl;
+    m_strandBuffer = new StrandBuffer();
+    m_strandBuffer->create(m_renderHairs);
 
-    for(int i = 0; i < strands.size(); ++i) {
-    //for(int i = 0; i < 2000; ++i) {
-        m_guideHairs.append(new Hair(strands.at(i),perStrandColor.at(i)));
-    }
     setAttributes(oldObject);
     m_simulation = simulation;
 }
@@ -287,17 +217,15 @@ void HairObject::setAttributes(glm::vec3 _color, int _numGroupHairs, float _hair
     m_hairColorVariation = _hairColorVariation;
 }
 
-void HairObject::update(float _time){
+void HairObject::update(float frameTime){
 
-    if (m_simulation != NULL)
-    {
-        m_simulation->simulate(this);
-    }
+    setGuidePositions(m_simulation != NULL ? m_simulation->advance(this, frameTime) : m_guideHairs.m_positions);
+}
 
-    for (int i = 0; i < m_guideHairs.size(); i++)
-    {
-        m_guideHairs.at(i)->update(_time);
-    }
+void HairObject::setGuidePositions(const std::vector<glm::vec3> &guidePositions)
+{
+    m_skinning.skin(m_renderHairs, m_guideHairs, guidePositions, m_renderPositions, m_pool);
+    m_strandBuffer->update(m_renderPositions);
 
 }
 
@@ -311,20 +239,6 @@ void HairObject::paint(ShaderProgram *program){
     program->uniforms.numSplineVertices = m_numSplineVertices;
     program->setPerObjectUniforms();
 
-    //cout<<m_guideHairs[0]->perStrandColor[0]<<","<<m_guideHairs[0]->perStrandColor[1]<<","<<m_guideHairs[0]->perStrandColor[2]<<endl;
-    //cout<<m_guideHairs.size()<<endl;
-    //for(int i=0;i<200;i++)
-    for (int i = 0; i < m_guideHairs.size(); i++)
-    {
-        //float r = ((float) rand()) / (float) RAND_MAX ;
-        //float g = ((float) rand()) / (float) RAND_MAX ;
-        //float b = ((float) rand()) / (float) RAND_MAX ;
-        //program->uniforms.color = glm::vec3(r,g,b);
-        program->uniforms.color = m_guideHairs[i]->perStrandColor;
-     //   cout<<"perStrandColor:"<<m_guideHairs[i]->perStrandColor.x<<","<<m_guideHairs[i]->perStrandColor.y<<","<<m_guideHairs[i]->perStrandColor.z<<endl;
-        //program->uniforms.color = glm::rgbColor(glm::vec3(m_color.x*255, m_color.y, m_color.z));
-        program->setPerObjectUniforms();
-        m_guideHairs.at(i)->paint(program);
-    }
-
+    // Per-strand vertices and colors come from m_strandBuffer, bound by the renderer.
+    m_strandBuffer->draw();
 }
@@ -5,10 +5,14 @@
 #include "hairCommon.h"
 #include "shaderprogram.h"
 #include "objmesh.h"
+#include "strandset.h"
+#include "guideskinning.h"
 
-class Hair;
 class Simulation;
 class Texture;
+class StrandBuffer;
+class SceneCache;
+class ThreadPool;
 
 class HairObject
 {
@@ -23,14 +27,22 @@ public:
                QImage &hairGroomingMap,
                Simulation *simulation,
                HairObject *oldObject = NULL);
-    // Generates hair with USC dataset
+    // Generates hair with USC dataset. The strands and blurred growth map are
+    // taken from cache instead if it is given and open.
     HairObject(const char* filename,
                QImage &hairGrowthMap,
                QImage &hairGroomingMap,
                Simulation *simulation,
-               HairObject *oldObject = NULL);
+               HairObject *oldObject = NULL,
+               SceneCache *cache = NULL);
+
+    // Advances the simulation by frameTime seconds of wall time and uploads
+    // the positions to draw.
+    void update(float frameTime);
 
-    void update(float _time);
+    // Moves the hair to the given guide hair positions, e.g. from a simulation
+    // cache, and uploads it.
+    void setGuidePositions(const std::vector<glm::vec3> &guidePositions);
     void paint(ShaderProgram *program);
     void setAttributes(HairObject *_oldObject);
     void setAttributes(
@@ -50,7 +62,18 @@ public:
 
 public:
 
-    QList<Hair*> m_guideHairs;
+    // Every strand that is drawn. Only m_guideHairs are simulated, and these
+    // follow them through m_skinning.
+    StrandSet m_renderHairs;
+    StrandSet m_guideHairs;
+    GuideSkinning m_skinning;
+    std::vector<glm::vec3> m_renderPositions;
+
+    // GPU copy of the rendered strands, drawn with one call per pass.
+    StrandBuffer *m_strandBuffer;
+
+    // Threads for skinning, the same ThreadPool::shared() the simulation steps on.
+    ThreadPool *m_pool;
 
     Simulation *m_simulation;
 
@@ -58,9 +81,6 @@ public:
     QImage m_hairGroomingMap;
     Texture *m_blurredHairGrowthMapTexture;
 
-    int m_numGuideHairs;
-    int m_numHairVertices;
-
     int m_numHairsPerPatch;
     int m_numGroupHairs;
     float m_hairGroupSpread;
@@ -0,0 +1,135 @@
+#include "hizbuffer.h"
+
+#include "quad.h"
+#include "hizdownsampleshaderprogram.h"
+#include "errorchecker.h"
+
+/*
+ * @file hizbuffer.cpp
+ *
+ * Hierarchical depth pyramid for occlusion culling
+ */
+
+HiZBuffer::HiZBuffer()
+{
+    m_size = m_numLevels = 0;
+    m_textureID = m_framebufferID = m_depthBufferID = 0;
+    m_quad = new Quad();
+    m_downsampleProgram = new HiZDownsampleShaderProgram();
+}
+
+HiZBuffer::~HiZBuffer()
+{
+    glDeleteTextures(1, &m_textureID);
+    glDeleteFramebuffers(1, &m_framebufferID);
+    glDeleteRenderbuffers(1, &m_depthBufferID);
+    safeDelete(m_quad);
+    safeDelete(m_downsampleProgram);
+}
+
+void HiZBuffer::init(int size)
+{
+    m_size = size;
+    m_numLevels = 1;
+    while ((size >> m_numLevels) > 0)
+        m_numLevels++;
+
+    glGenTextures(1, &m_textureID);
+    glBindTexture(GL_TEXTURE_2D, m_textureID);
+    for (int level = 0; level < m_numLevels; level++)
+    {
+        int levelSize = std::max(size >> level, 1);
+        glTexImage2D(GL_TEXTURE_2D, level, GL_R32F, levelSize, levelSize, 0, GL_RED, GL_FLOAT, NULL);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, m_numLevels - 1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenRenderbuffers(1, &m_depthBufferID);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_depthBufferID);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, size, size);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &m_framebufferID);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebufferID);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_textureID, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthBufferID);
+    GLenum framebufferStatus = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (framebufferStatus != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "Hi-Z framebuffer not complete. Status: " << framebufferStatus << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    m_quad->init();
+    m_downsampleProgram->create();
+
+    ErrorChecker::printGLErrors("end of HiZBuffer::init");
+}
+
+void HiZBuffer::begin()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebufferID);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_textureID, 0);
+    glViewport(0, 0, m_size, m_size);
+    glEnable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+    glClearColor(1.f, 1.f, 1.f, 1.f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void HiZBuffer::end()
+{
+    glDisable(GL_DEPTH_TEST);
+    m_downsampleProgram->bind();
+    m_downsampleProgram->uniforms.hiZMap = 0;
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_textureID);
+
+    // Restrict the mip range to the level below while writing the next one,
+    // so no level is sampled and rendered to at once.
+    for (int level = 1; level < m_numLevels; level++)
+    {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level - 1);
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_textureID, level);
+        glViewport(0, 0, std::max(m_size >> level, 1), std::max(m_size >> level, 1));
+        m_downsampleProgram->setGlobalUniforms();
+        m_quad->draw();
+    }
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, m_numLevels - 1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    m_downsampleProgram->unbind();
+
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_textureID, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glEnable(GL_DEPTH_TEST);
+}
+
+void HiZBuffer::bind(GLenum textureUnit)
+{
+    glActiveTexture(textureUnit);
+    glBindTexture(GL_TEXTURE_2D, m_textureID);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void HiZBuffer::unbind(GLenum textureUnit)
+{
+    glActiveTexture(textureUnit);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+int HiZBuffer::size()
+{
+    return m_size;
+}
+
+int HiZBuffer::numLevels()
+{
+    return m_numLevels;
+}
@@ -0,0 +1,51 @@
+#ifndef HIZBUFFER_H
+#define HIZBUFFER_H
+
+#include "hairCommon.h"
+
+class Quad;
+class ShaderProgram;
+
+/**
+ * Hierarchical depth (Hi-Z) pyramid of the occluders in view, for culling the
+ * hair behind them. Level 0 holds the window depth of the occluders drawn
+ * between begin() and end(); each further level holds the farthest depth of
+ * the 2x2 texels below it, so a single lookup at the right level tells
+ * whether anything in a screen rectangle could be in front of the occluders.
+ *
+ * The pyramid is square and a power of two in size whatever the aspect of
+ * the view; it only needs to be conservative, not sharp.
+ */
+class HiZBuffer
+{
+public:
+    HiZBuffer();
+    virtual ~HiZBuffer();
+
+    void init(int size);
+
+    // Binds level 0 for drawing and clears it to the far plane. Occluders
+    // are drawn with a program writing gl_FragCoord.z (see meshdepth.frag).
+    void begin();
+
+    // Builds the remaining levels from level 0.
+    void end();
+
+    void bind(GLenum textureUnit);
+    void unbind(GLenum textureUnit);
+
+    int size();
+    int numLevels();
+
+private:
+    int m_size, m_numLevels;
+
+    GLuint m_textureID; // R32F with a full mip chain
+    GLuint m_framebufferID;
+    GLuint m_depthBufferID; // Depth test while drawing level 0
+
+    Quad *m_quad;
+    ShaderProgram *m_downsampleProgram;
+};
+
+#endif // HIZBUFFER_H
@@ -0,0 +1,121 @@
+#include "exrwriter.h"
+
+#include <QImage>
+#include <stdint.h>
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// Everything in an EXR file is little endian.
+static void putInt(std::string &out, int32_t value)
+{
+    for (int i = 0; i < 4; i++)
+        out.push_back((char) ((value >> (8 * i)) & 0xff));
+}
+
+static void putFloat(std::string &out, float value)
+{
+    int32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    putInt(out, bits);
+}
+
+static void putAttribute(std::string &out, const char *name, const char *type, const std::string &value)
+{
+    out.append(name).push_back('\0');
+    out.append(type).push_back('\0');
+    putInt(out, value.size());
+    out.append(value);
+}
+
+static float srgbToLinear(int value)
+{
+    float c = value / 255.f;
+    return c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+}
+
+bool EXRWriter::write(const char *filename, const QImage &source)
+{
+    QImage image = source.convertToFormat(QImage::Format_RGB32);
+    int width = image.width(), height = image.height();
+
+    std::string header;
+    putInt(header, 20000630); // Magic number
+    putInt(header, 2);        // Version 2, single-part scanline file
+
+    // Channels must be listed, and stored, in alphabetical order.
+    const char channelNames[3] = {'B', 'G', 'R'};
+    std::string channels;
+    for (int c = 0; c < 3; c++)
+    {
+        channels.push_back(channelNames[c]);
+        channels.push_back('\0');
+        putInt(channels, 2);        // FLOAT
+        putInt(channels, 0);        // pLinear and reserved bytes
+        putInt(channels, 1);        // x sampling
+        putInt(channels, 1);        // y sampling
+    }
+    channels.push_back('\0');
+    putAttribute(header, "channels", "chlist", channels);
+
+    putAttribute(header, "compression", "compression", std::string(1, '\0'));
+
+    std::string window;
+    putInt(window, 0);
+    putInt(window, 0);
+    putInt(window, width - 1);
+    putInt(window, height - 1);
+    putAttribute(header, "dataWindow", "box2i", window);
+    putAttribute(header, "displayWindow", "box2i", window);
+
+    putAttribute(header, "lineOrder", "lineOrder", std::string(1, '\0')); // Increasing y
+
+    std::string value;
+    putFloat(value, 1.f);
+    putAttribute(header, "pixelAspectRatio", "float", value);
+    value.clear();
+    putFloat(value, 0.f);
+    putFloat(value, 0.f);
+    putAttribute(header, "screenWindowCenter", "v2f", value);
+    value.clear();
+    putFloat(value, 1.f);
+    putAttribute(header, "screenWindowWidth", "float", value);
+    header.push_back('\0');
+
+    // Uncompressed files store one scanline per chunk, each found through the offset table.
+    int32_t lineSize = 3 * width * sizeof(float);
+    uint64_t chunkSize = 8 + lineSize;
+    uint64_t firstChunk = header.size() + height * sizeof(uint64_t);
+    for (int y = 0; y < height; y++)
+    {
+        uint64_t offset = firstChunk + y * chunkSize;
+        putInt(header, (int32_t) (offset & 0xffffffff));
+        putInt(header, (int32_t) (offset >> 32));
+    }
+
+    FILE *f = fopen(filename, "wb");
+    if (!f)
+        return false;
+    bool written = fwrite(header.data(), header.size(), 1, f) == 1;
+
+    std::string line;
+    line.reserve(chunkSize);
+    for (int y = 0; written && y < height; y++)
+    {
+        const QRgb *pixels = (const QRgb *) image.constScanLine(y);
+        line.clear();
+        putInt(line, y);
+        putInt(line, lineSize);
+        for (int x = 0; x < width; x++)
+            putFloat(line, srgbToLinear(qBlue(pixels[x])));
+        for (int x = 0; x < width; x++)
+            putFloat(line, srgbToLinear(qGreen(pixels[x])));
+        for (int x = 0; x < width; x++)
+            putFloat(line, srgbToLinear(qRed(pixels[x])));
+        written = fwrite(line.data(), line.size(), 1, f) == 1;
+    }
+
+    return fclose(f) == 0 && written;
+}
@@ -0,0 +1,17 @@
+#ifndef EXRWRITER_H
+#define EXRWRITER_H
+
+class QImage;
+
+/**
+ * Writes images as uncompressed single-part scanline OpenEXR files with 32-bit
+ * float R, G and B channels. Pixels are converted from sRGB to linear, which
+ * is what EXR readers expect.
+ */
+class EXRWriter
+{
+public:
+    static bool write(const char *filename, const QImage &image);
+};
+
+#endif // EXRWRITER_H
@@ -0,0 +1,143 @@
+#include "hairloader.h"
+
+#include "strandset.h"
+#include "threadpool.h"
+#include "mappedfile.h"
+#include "pcgrandom.h"
+#include <cyHairFile.h>
+
+#include <cstring>
+#include <algorithm>
+
+#define STRANDS_PER_CHUNK 256
+
+std::string HairLoader::colorFilename(const char *filename)
+{
+    std::string name = filename;
+    return name.substr(0, name.size() - std::min<size_t>(name.size(), 4)) + "bin";
+}
+
+bool HairLoader::loadCyHair(const char *filename, StrandSet &strands)
+{
+    strands.clear();
+
+    MappedFile file(filename);
+    if (!file.valid())
+    {
+        cerr << "Couldn't open " << filename << endl;
+        return false;
+    }
+
+    cyHairFile::Header header;
+    if (file.size() < sizeof(header))
+    {
+        cerr << filename << " is too short for a hair file header" << endl;
+        return false;
+    }
+    memcpy(&header, file.data(), sizeof(header));
+    if (strncmp(header.signature, "HAIR", 4) != 0 && strncmp(header.signature, "hair", 4) != 0)
+    {
+        cerr << filename << " is not a hair file" << endl;
+        return false;
+    }
+    if (!(header.arrays & CY_HAIR_FILE_POINTS_BIT))
+    {
+        cerr << filename << " has no hair points" << endl;
+        return false;
+    }
+
+    // The arrays follow the header in a fixed order; only segments and points are used.
+    int numStrands = header.hair_count;
+    int numPoints = header.point_count;
+    size_t offset = sizeof(header);
+    const char *segments = NULL;
+    if (header.arrays & CY_HAIR_FILE_SEGMENTS_BIT)
+    {
+        segments = file.data() + offset;
+        offset += numStrands * sizeof(unsigned short);
+    }
+    const char *points = file.data() + offset;
+    offset += numPoints * 3 * sizeof(float);
+    if (offset > file.size())
+    {
+        cerr << filename << " is truncated" << endl;
+        return false;
+    }
+
+    // Lay out the strand ranges. The arrays in the mapping are not necessarily
+    // aligned, so they are read with memcpy.
+    strands.resize(numStrands, numPoints);
+    int numVertices = 0;
+    for (int i = 0; i < numStrands; ++i)
+    {
+        unsigned short numSegments = header.d_segments;
+        if (segments)
+            memcpy(&numSegments, segments + i * sizeof(unsigned short), sizeof(unsigned short));
+        strands.m_firstVertex[i] = numVertices;
+        strands.m_numVertices[i] = numSegments + 1;
+        numVertices += numSegments + 1;
+    }
+    if (numVertices != numPoints)
+    {
+        cerr << filename << " has " << numPoints << " points, but its strands need " << numVertices << endl;
+        strands.clear();
+        return false;
+    }
+
+    // Per-point colors, if there is a companion color file of the right size.
+    std::string colorName = colorFilename(filename);
+    MappedFile colorFile(colorName.c_str());
+    const char *colors = NULL;
+    if (colorFile.valid() && colorFile.size() >= numPoints * 3 * sizeof(double))
+        colors = colorFile.data();
+    else
+        cout << "no valid color values found from " << colorName << endl;
+
+    // Drawn up front so the colors do not depend on how strands are spread over threads.
+    std::vector<glm::vec3> randomColors;
+    if (!colors)
+    {
+        PcgRandom random(RANDOM_STREAM_STRAND_COLORS);
+        randomColors.resize(numStrands);
+        for (int i = 0; i < numStrands; ++i)
+        {
+            float r = random.uniform();
+            float g = random.uniform();
+            float b = random.uniform();
+            randomColors[i] = glm::vec3(r, g, b);
+        }
+    }
+
+    cout << "hair count:" << numStrands << endl;
+
+    ThreadPool::shared()->parallelFor(numStrands, STRANDS_PER_CHUNK, [&](int beginStrand, int endStrand)
+    {
+        for (int i = beginStrand; i < endStrand; ++i)
+        {
+            int first = strands.m_firstVertex[i];
+            int end = first + strands.m_numVertices[i];
+
+            glm::vec3 color = glm::vec3(0.0);
+            for (int j = first; j < end; ++j)
+            {
+                memcpy(&strands.m_positions[j][0], points + j * 3 * sizeof(float), 3 * sizeof(float));
+
+                if (colors)
+                {
+                    double rgb[3];
+                    memcpy(rgb, colors + j * 3 * sizeof(double), 3 * sizeof(double));
+                    color += glm::vec3(rgb[0], rgb[1], rgb[2]);
+                }
+            }
+
+            if (colors)
+                color /= std::max(end - first - 1, 1) * 255.0f; // Divided by the segment count, as before.
+            else
+                color = randomColors[i];
+
+            strands.finishStrand(i, color);
+        }
+    });
+
+    return true;
+}
@@ -0,0 +1,28 @@
+#ifndef HAIRLOADER_H
+#define HAIRLOADER_H
+
+#include "hairCommon.h"
+
+class StrandSet;
+
+/**
+ * Loads cyHair (.hair) files straight into a StrandSet. The file is memory
+ * mapped, the strand ranges are laid out from the segment counts, and the
+ * points are written into place in parallel without any intermediate
+ * per-strand containers. Points are kept in the file's own space; rotating
+ * the model is up to the renderer.
+ *
+ * Strand colors come from an optional companion file next to the .hair file
+ * with the extension replaced by "bin": three doubles in [0, 255] per point,
+ * averaged over each strand. Without it every strand gets a random color.
+ */
+class HairLoader
+{
+public:
+    static bool loadCyHair(const char *filename, StrandSet &strands);
+
+    // Name of the companion color file of a .hair file.
+    static std::string colorFilename(const char *filename);
+};
+
+#endif // HAIRLOADER_H
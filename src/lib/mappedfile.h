@@ -0,0 +1,22 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+
+// Read-only view of a whole file, unmapped when it goes out of scope.
+class MappedFile
+{
+public:
+    MappedFile(const char *filename);
+    virtual ~MappedFile();
+
+    bool valid() const { return m_data != NULL; }
+    size_t size() const { return m_size; }
+    const char *data() const { return m_data; }
+
+private:
+    const char *m_data;
+    size_t m_size;
+};
+
+#endif // MAPPEDFILE_H
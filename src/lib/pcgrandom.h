@@ -0,0 +1,75 @@
+#ifndef PCGRANDOM_H
+#define PCGRANDOM_H
+
+#include <stdint.h>
+
+// Streams of the subsystems that draw random numbers.
+#define RANDOM_STREAM_HAIR_GROWTH 1
+#define RANDOM_STREAM_STRAND_COLORS 2
+#define RANDOM_STREAM_GUIDES 3
+
+/**
+ * Small random number generator (PCG32: a 64 bit LCG with a permuted 32 bit
+ * output). Each subsystem that needs random numbers owns one on its own
+ * stream, so what one of them draws never shifts the numbers another sees,
+ * and everything follows from the global seed: the same seed reproduces the
+ * same hair, whatever else ran before.
+ *
+ * Also a UniformRandomBitGenerator, but what std::shuffle and the standard
+ * distributions make of its numbers differs between standard libraries;
+ * code that has to reproduce across machines draws with bounded() instead.
+ */
+class PcgRandom
+{
+public:
+    typedef uint32_t result_type;
+
+    PcgRandom(uint64_t stream, uint64_t seed = globalSeed())
+    {
+        m_state = 0;
+        m_increment = (stream << 1) | 1;
+        next();
+        m_state += seed;
+        next();
+    }
+
+    uint32_t next()
+    {
+        uint64_t state = m_state;
+        m_state = state * 6364136223846793005ULL + m_increment;
+        uint32_t xorShifted = (uint32_t) (((state >> 18) ^ state) >> 27);
+        uint32_t rotation = (uint32_t) (state >> 59);
+        return (xorShifted >> rotation) | (xorShifted << ((-rotation) & 31));
+    }
+
+    // Uniform in [0, bound), without the bias of a plain modulo.
+    uint32_t bounded(uint32_t bound)
+    {
+        uint32_t threshold = (0u - bound) % bound;
+        while (true)
+        {
+            uint32_t r = next();
+            if (r >= threshold)
+                return r % bound;
+        }
+    }
+
+    // In [0, 1).
+    float uniform() { return (next() >> 8) * (1.f / 16777216.f); }
+
+    uint32_t operator()() { return next(); }
+    static constexpr uint32_t min() { return 0; }
+    static constexpr uint32_t max() { return 0xffffffffu; }
+
+    // Seed of generators created without one; 0 unless set with --seed.
+    static uint64_t globalSeed() { return _seed(); }
+    static void setGlobalSeed(uint64_t seed) { _seed() = seed; }
+
+private:
+    static uint64_t &_seed() { static uint64_t seed = 0; return seed; }
+
+    uint64_t m_state;
+    uint64_t m_increment;
+};
+
+#endif // PCGRANDOM_H
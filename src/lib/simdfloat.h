@@ -0,0 +1,118 @@
+#ifndef SIMDFLOAT_H
+#define SIMDFLOAT_H
+
+/**
+ * A pack of SIMD_WIDTH floats with the handful of operations the strand
+ * solver needs. The width is picked at compile time from the instruction set
+ * the compiler targets (8 with AVX2, 4 with SSE2, otherwise 1), and can be
+ * forced by defining HAIR_SIMD_WIDTH to 1, 4 or 8.
+ */
+
+#ifndef HAIR_SIMD_WIDTH
+#  if defined(__AVX2__)
+#    define HAIR_SIMD_WIDTH 8
+#  elif defined(__SSE2__) || defined(_M_X64)
+#    define HAIR_SIMD_WIDTH 4
+#  else
+#    define HAIR_SIMD_WIDTH 1
+#  endif
+#endif
+
+#if HAIR_SIMD_WIDTH == 8
+#  include <immintrin.h>
+#elif HAIR_SIMD_WIDTH == 4
+#  include <xmmintrin.h>
+#elif HAIR_SIMD_WIDTH == 1
+#  include <math.h>
+#else
+#  error "HAIR_SIMD_WIDTH must be 1, 4 or 8"
+#endif
+
+#define SIMD_WIDTH HAIR_SIMD_WIDTH
+
+struct SimdFloat
+{
+#if SIMD_WIDTH == 8
+    __m256 v;
+
+    SimdFloat() {}
+    SimdFloat(__m256 v) : v(v) {}
+    SimdFloat(float f) : v(_mm256_set1_ps(f)) {}
+
+    static SimdFloat load(const float *p) { return _mm256_loadu_ps(p); }
+    void store(float *p) const { _mm256_storeu_ps(p, v); }
+#elif SIMD_WIDTH == 4
+    __m128 v;
+
+    SimdFloat() {}
+    SimdFloat(__m128 v) : v(v) {}
+    SimdFloat(float f) : v(_mm_set1_ps(f)) {}
+
+    static SimdFloat load(const float *p) { return _mm_loadu_ps(p); }
+    void store(float *p) const { _mm_storeu_ps(p, v); }
+#else
+    float v;
+
+    SimdFloat() {}
+    SimdFloat(float f) : v(f) {}
+
+    static SimdFloat load(const float *p) { return *p; }
+    void store(float *p) const { *p = v; }
+#endif
+};
+
+#if SIMD_WIDTH == 8
+
+inline SimdFloat operator+(SimdFloat a, SimdFloat b) { return _mm256_add_ps(a.v, b.v); }
+inline SimdFloat operator-(SimdFloat a, SimdFloat b) { return _mm256_sub_ps(a.v, b.v); }
+inline SimdFloat operator*(SimdFloat a, SimdFloat b) { return _mm256_mul_ps(a.v, b.v); }
+inline SimdFloat max(SimdFloat a, SimdFloat b) { return _mm256_max_ps(a.v, b.v); }
+inline SimdFloat min(SimdFloat a, SimdFloat b) { return _mm256_min_ps(a.v, b.v); }
+inline SimdFloat rsqrtEstimate(SimdFloat a) { return _mm256_rsqrt_ps(a.v); }
+
+#elif SIMD_WIDTH == 4
+
+inline SimdFloat operator+(SimdFloat a, SimdFloat b) { return _mm_add_ps(a.v, b.v); }
+inline SimdFloat operator-(SimdFloat a, SimdFloat b) { return _mm_sub_ps(a.v, b.v); }
+inline SimdFloat operator*(SimdFloat a, SimdFloat b) { return _mm_mul_ps(a.v, b.v); }
+inline SimdFloat max(SimdFloat a, SimdFloat b) { return _mm_max_ps(a.v, b.v); }
+inline SimdFloat min(SimdFloat a, SimdFloat b) { return _mm_min_ps(a.v, b.v); }
+inline SimdFloat rsqrtEstimate(SimdFloat a) { return _mm_rsqrt_ps(a.v); }
+
+#else
+
+inline SimdFloat operator+(SimdFloat a, SimdFloat b) { return a.v + b.v; }
+inline SimdFloat operator-(SimdFloat a, SimdFloat b) { return a.v - b.v; }
+inline SimdFloat operator*(SimdFloat a, SimdFloat b) { return a.v * b.v; }
+inline SimdFloat max(SimdFloat a, SimdFloat b) { return a.v > b.v ? a.v : b.v; }
+inline SimdFloat min(SimdFloat a, SimdFloat b) { return a.v < b.v ? a.v : b.v; }
+inline SimdFloat rsqrtEstimate(SimdFloat a) { return 1.f / sqrtf(a.v); }
+
+#endif
+
+// 1 / sqrt(a) from a correctly rounded square root and division: slower than
+// rsqrt, but the same on every CPU, which the hardware estimate is not.
+inline SimdFloat rsqrtExact(SimdFloat a)
+{
+#if SIMD_WIDTH == 8
+    return _mm256_div_ps(_mm256_set1_ps(1.f), _mm256_sqrt_ps(a.v));
+#elif SIMD_WIDTH == 4
+    return _mm_div_ps(_mm_set1_ps(1.f), _mm_sqrt_ps(a.v));
+#else
+    return 1.f / sqrtf(a.v);
+#endif
+}
+
+// 1 / sqrt(a), refined from the hardware estimate (about 12 bits) with one
+// Newton-Raphson step to nearly full float precision.
+inline SimdFloat rsqrt(SimdFloat a)
+{
+#if SIMD_WIDTH == 1
+    return rsqrtEstimate(a);
+#else
+    SimdFloat y = rsqrtEstimate(a);
+    return y * (SimdFloat(1.5f) - SimdFloat(0.5f) * a * y * y);
+#endif
+}
+
+#endif // SIMDFLOAT_H
@@ -0,0 +1,135 @@
+#include "threadpool.h"
+
+#include <unistd.h>
+#include <algorithm>
+#include <iostream>
+
+ThreadPool::ThreadPool(int numThreads)
+{
+    if (numThreads <= 0)
+        numThreads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (numThreads <= 0)
+        numThreads = 1;
+
+    pthread_mutex_init(&m_loopMutex, NULL);
+    pthread_mutex_init(&m_mutex, NULL);
+    pthread_cond_init(&m_workCond, NULL);
+    pthread_cond_init(&m_doneCond, NULL);
+    m_generation = 0;
+    m_numBusy = 0;
+    m_quit = false;
+    m_body = NULL;
+    m_count = 0;
+    m_chunkSize = 1;
+    m_nextChunk = 0;
+
+    // The calling thread works too, so it needs one helper less.
+    for (int i = 0; i < numThreads - 1; ++i)
+    {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, _workerThread, this))
+        {
+            std::cerr << "ThreadPool: could not create worker thread " << i << std::endl;
+            break;
+        }
+        m_threads.push_back(thread);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    pthread_mutex_lock(&m_mutex);
+    m_quit = true;
+    pthread_cond_broadcast(&m_workCond);
+    pthread_mutex_unlock(&m_mutex);
+
+    for (unsigned int i = 0; i < m_threads.size(); ++i)
+        pthread_join(m_threads[i], NULL);
+
+    pthread_cond_destroy(&m_doneCond);
+    pthread_cond_destroy(&m_workCond);
+    pthread_mutex_destroy(&m_mutex);
+    pthread_mutex_destroy(&m_loopMutex);
+}
+
+ThreadPool *ThreadPool::shared()
+{
+    static ThreadPool pool;
+    return &pool;
+}
+
+int ThreadPool::numThreads() const
+{
+    return m_threads.size() + 1;
+}
+
+void ThreadPool::parallelFor(int count, int chunkSize, const std::function<void(int, int)> &body)
+{
+    if (count <= 0)
+        return;
+    chunkSize = std::max(chunkSize, 1);
+
+    // Not worth waking anyone up for a single chunk.
+    if (m_threads.empty() || count <= chunkSize)
+    {
+        body(0, count);
+        return;
+    }
+
+    pthread_mutex_lock(&m_loopMutex);
+    pthread_mutex_lock(&m_mutex);
+    m_body = &body;
+    m_count = count;
+    m_chunkSize = chunkSize;
+    m_nextChunk = 0;
+    m_numBusy = m_threads.size();
+    m_generation++;
+    pthread_cond_broadcast(&m_workCond);
+    pthread_mutex_unlock(&m_mutex);
+
+    _runChunks();
+
+    pthread_mutex_lock(&m_mutex);
+    while (m_numBusy > 0)
+        pthread_cond_wait(&m_doneCond, &m_mutex);
+    m_body = NULL;
+    pthread_mutex_unlock(&m_mutex);
+    pthread_mutex_unlock(&m_loopMutex);
+}
+
+void ThreadPool::_runChunks()
+{
+    while (true)
+    {
+        int begin = m_nextChunk.fetch_add(1) * m_chunkSize;
+        if (begin >= m_count)
+            break;
+        (*m_body)(begin, std::min(begin + m_chunkSize, m_count));
+    }
+}
+
+void* ThreadPool::_workerThread(void *untypedPool)
+{
+    ThreadPool *pool = (ThreadPool *) untypedPool;
+    int generation = 0;
+
+    pthread_mutex_lock(&pool->m_mutex);
+    while (true)
+    {
+        while (pool->m_generation == generation && !pool->m_quit)
+            pthread_cond_wait(&pool->m_workCond, &pool->m_mutex);
+        if (pool->m_quit)
+            break;
+        generation = pool->m_generation;
+
+        pthread_mutex_unlock(&pool->m_mutex);
+        pool->_runChunks();
+        pthread_mutex_lock(&pool->m_mutex);
+
+        if (--pool->m_numBusy == 0)
+            pthread_cond_signal(&pool->m_doneCond);
+    }
+    pthread_mutex_unlock(&pool->m_mutex);
+
+    return NULL;
+}
@@ -0,0 +1,60 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <pthread.h>
+#include <atomic>
+#include <functional>
+#include <vector>
+
+/**
+ * A fixed set of worker threads that stay alive between frames. Work is handed
+ * out as a parallel for loop: the range is cut into chunks, and the workers and
+ * the calling thread keep claiming the next unclaimed chunk until none are left,
+ * so threads that finish early take over the remaining work.
+ *
+ * The whole process shares one pool sized to the hardware (shared()), so
+ * stages running on different threads, like the simulation thread and
+ * skinning for the renderer, never ask for more threads than there are
+ * cores. Loops started from different threads run one after the other.
+ *
+ * parallelFor must not be called from inside a loop body.
+ */
+class ThreadPool
+{
+public:
+    // Uses one thread per core (counting the calling thread) if numThreads is 0.
+    ThreadPool(int numThreads = 0);
+    virtual ~ThreadPool();
+
+    // The pool everything in the process runs on, created on first use.
+    static ThreadPool *shared();
+
+    // Number of threads that run loop bodies, including the calling thread.
+    int numThreads() const;
+
+    // Calls body(begin, end) for consecutive chunks of [0, count) of at most
+    // chunkSize elements and returns once all of them are done.
+    void parallelFor(int count, int chunkSize, const std::function<void(int, int)> &body);
+
+private:
+    static void* _workerThread(void *pool);
+    void _runChunks();
+
+    std::vector<pthread_t> m_threads;
+
+    pthread_mutex_t m_loopMutex; // Held for a whole loop, so callers on other threads wait their turn.
+    pthread_mutex_t m_mutex;
+    pthread_cond_t m_workCond; // Signalled when a new loop starts or the pool shuts down.
+    pthread_cond_t m_doneCond; // Signalled when the last worker finishes a loop.
+    int m_generation;          // Incremented for every loop, so workers run each one once.
+    int m_numBusy;
+    bool m_quit;
+
+    // Current loop
+    const std::function<void(int, int)> *m_body;
+    int m_count;
+    int m_chunkSize;
+    std::atomic<int> m_nextChunk;
+};
+
+#endif // THREADPOOL_H
@@ -1,28 +1,105 @@
 #include <QApplication>
 #include "mainwindow.h"
+#include "batchrenderer.h"
 #include "string"
 #include "math.h"
+#include "pcgrandom.h"
 
 std::string hairstyle_file;
 std::string headmodel_file;
 float X_angle = 0.0;
 float Y_angle = 0.0;
 float Z_angle = 0.0;
-std::string save_image;
+bool deterministic_mode = false;
+std::string state_dump_file;
+std::string bake_file;
+std::string playback_file;
 
 int main(int argc, char *argv[])
 {
-    hairstyle_file.append(argv[1]);
-    if(argc>2){
-        headmodel_file.append(argv[2]);
-        X_angle = atof(argv[3])/180*M_PI;
-        Y_angle = atof(argv[4])/180*M_PI;
-        Z_angle = atof(argv[5])/180*M_PI;
+    // Options can go anywhere; what is left are the positional arguments.
+    //   --seed <n>             seed of all random numbers (hair growth, colors, guides)
+    //   --deterministic        reproducible simulation, see Simulation::m_deterministic
+    //   --dump-states <file>   deterministic, and dumps every step (see Simulation::dumpStates)
+    //   --bake <file>          records the simulation into a cache (see SimulationCache)
+    //   --play <file>          plays a recorded cache instead of simulating
+    std::vector<char *> args;
+    for (int i = 0; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            PcgRandom::setGlobalSeed(strtoull(argv[++i], NULL, 10));
+        }
+        else if (strcmp(argv[i], "--deterministic") == 0)
+        {
+            deterministic_mode = true;
+        }
+        else if (strcmp(argv[i], "--dump-states") == 0 && i + 1 < argc)
+        {
+            deterministic_mode = true;
+            state_dump_file = argv[++i];
+        }
+        else if (strcmp(argv[i], "--bake") == 0 && i + 1 < argc)
+        {
+            bake_file = argv[++i];
+        }
+        else if (strcmp(argv[i], "--play") == 0 && i + 1 < argc)
+        {
+            playback_file = argv[++i];
+        }
+        else
+        {
+            args.push_back(argv[i]);
+        }
     }
-    if(argc>6){
-        save_image.append(argv[6]);
+    argc = args.size();
+    args.push_back(NULL);
+    argv = args.data();
+
+    QList<RenderJob> jobs;
+    bool batch = false;
+
+    if (argc > 2 && strcmp(argv[1], "--batch") == 0)
+    {
+        // Batch mode: ./hair --batch <job file>
+        if (!BatchRenderer::readJobFile(argv[2], jobs))
+            return 1;
+        batch = true;
+    }
+    else
+    {
+        hairstyle_file.append(argv[1]);
+        if(argc>2){
+            headmodel_file.append(argv[2]);
+            X_angle = atof(argv[3])/180*M_PI;
+            Y_angle = atof(argv[4])/180*M_PI;
+            Z_angle = atof(argv[5])/180*M_PI;
+        }
+        //hairstyle_file.append("./hairfiles/strands00001.data");
+
+        // Rendering a single image is a batch of one job.
+        if(argc>6){
+            RenderJob job;
+            job.hairFile = hairstyle_file;
+            job.meshFile = headmodel_file;
+            job.angles = glm::vec3(X_angle, Y_angle, Z_angle);
+            job.outputFile = argv[6];
+            job.simulationFrame = -1;
+            jobs.append(job);
+            batch = true;
+        }
     }
-    //hairstyle_file.append("./hairfiles/strands00001.data");
+
+    if (batch)
+    {
+        // Batch renders never open a window, so Qt does not need a display either.
+        if (qgetenv("DISPLAY").isEmpty() && qgetenv("QT_QPA_PLATFORM").isEmpty())
+            qputenv("QT_QPA_PLATFORM", "offscreen");
+        QApplication a(argc, argv);
+        BatchRenderer renderer;
+        return renderer.run(jobs) == 0 ? 0 : 1;
+    }
+
     QApplication a(argc, argv);
     MainWindow w;
     w.show();
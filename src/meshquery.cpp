@@ -0,0 +1,349 @@
+#include "meshquery.h"
+
+#include "threadpool.h"
+
+#include <algorithm>
+
+// Deep enough for any tree cyBVH builds from a mesh that fits in memory.
+#define MAX_STACK_DEPTH 64
+
+// Queries handed to a pool thread at a time
+#define QUERIES_PER_CHUNK 256
+
+// Ray direction for inside tests, chosen to be unlikely to run along mesh edges.
+#define CONTAINS_DIRECTION glm::vec3(0.5377f, 0.8319f, 0.1371f)
+
+// Distance along ro + t * rd to the triangle, and barycentric coordinates of the
+// hit (Moller-Trumbore).
+static bool rayTriangle(glm::vec3 ro, glm::vec3 rd, const Triangle &t, float &distance, glm::vec3 &bary)
+{
+    glm::vec3 edge1 = t.v2 - t.v1;
+    glm::vec3 edge2 = t.v3 - t.v1;
+    glm::vec3 pVec = glm::cross(rd, edge2);
+    float det = glm::dot(edge1, pVec);
+    if (det == 0) return false;
+    float invDet = 1.f / det;
+
+    glm::vec3 tVec = ro - t.v1;
+    float u = glm::dot(tVec, pVec) * invDet;
+    if (u < 0 || u > 1) return false;
+
+    glm::vec3 qVec = glm::cross(tVec, edge1);
+    float v = glm::dot(rd, qVec) * invDet;
+    if (v < 0 || u + v > 1) return false;
+
+    distance = glm::dot(edge2, qVec) * invDet;
+    bary = glm::vec3(1 - u - v, u, v);
+    return true;
+}
+
+// Entry distance of the ray into the box, or a negative value if it misses
+// the box within [0, maxDistance].
+static float rayBox(glm::vec3 ro, glm::vec3 invRd, const float *box, float maxDistance)
+{
+    glm::vec3 t0 = (glm::vec3(box[0], box[1], box[2]) - ro) * invRd;
+    glm::vec3 t1 = (glm::vec3(box[3], box[4], box[5]) - ro) * invRd;
+    glm::vec3 tMin = glm::min(t0, t1), tMax = glm::max(t0, t1);
+    float tNear = std::max(std::max(tMin.x, tMin.y), std::max(tMin.z, 0.f));
+    float tFar = std::min(std::min(tMax.x, tMax.y), std::min(tMax.z, maxDistance));
+    return tNear <= tFar ? tNear : -1;
+}
+
+static float boxDistance2(glm::vec3 p, const float *box)
+{
+    glm::vec3 d = glm::max(glm::vec3(box[0], box[1], box[2]) - p, glm::vec3(0));
+    d = glm::max(d, p - glm::vec3(box[3], box[4], box[5]));
+    return glm::dot(d, d);
+}
+
+MeshQuery::MeshQuery()
+{
+    m_triangles = NULL;
+}
+
+void MeshQuery::build(const std::vector<Triangle> *triangles)
+{
+    m_triangles = triangles;
+    Build(triangles->size());
+}
+
+bool MeshQuery::empty() const
+{
+    return m_triangles == NULL || m_triangles->empty();
+}
+
+const std::vector<Triangle> &MeshQuery::triangles() const
+{
+    return *m_triangles;
+}
+
+void MeshQuery::bounds(glm::vec3 &min, glm::vec3 &max) const
+{
+    const float *box = GetNodeBounds(GetRootNodeID());
+    min = glm::vec3(box[0], box[1], box[2]);
+    max = glm::vec3(box[3], box[4], box[5]);
+}
+
+void MeshQuery::GetElementBounds(unsigned int i, float box[6]) const
+{
+    const Triangle &t = (*m_triangles)[i];
+    glm::vec3 min = glm::min(t.v1, glm::min(t.v2, t.v3));
+    glm::vec3 max = glm::max(t.v1, glm::max(t.v2, t.v3));
+    box[0] = min.x; box[1] = min.y; box[2] = min.z;
+    box[3] = max.x; box[4] = max.y; box[5] = max.z;
+}
+
+float MeshQuery::GetElementCenter(unsigned int i, int dimension) const
+{
+    const Triangle &t = (*m_triangles)[i];
+    return (t.v1[dimension] + t.v2[dimension] + t.v3[dimension]) / 3.f;
+}
+
+glm::vec3 MeshQuery::closestPointOnTriangle(glm::vec3 p, const Triangle &t, glm::vec3 &bary)
+{
+    // Ericson, Real-Time Collision Detection, 5.1.5
+    glm::vec3 ab = t.v2 - t.v1, ac = t.v3 - t.v1, ap = p - t.v1;
+    float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+    if (d1 <= 0 && d2 <= 0) { bary = glm::vec3(1, 0, 0); return t.v1; }
+
+    glm::vec3 bp = p - t.v2;
+    float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+    if (d3 >= 0 && d4 <= d3) { bary = glm::vec3(0, 1, 0); return t.v2; }
+
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0 && d1 >= 0 && d3 <= 0)
+    {
+        float v = d1 / (d1 - d3);
+        bary = glm::vec3(1 - v, v, 0);
+        return t.v1 + v * ab;
+    }
+
+    glm::vec3 cp = p - t.v3;
+    float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+    if (d6 >= 0 && d5 <= d6) { bary = glm::vec3(0, 0, 1); return t.v3; }
+
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0 && d2 >= 0 && d6 <= 0)
+    {
+        float w = d2 / (d2 - d6);
+        bary = glm::vec3(1 - w, 0, w);
+        return t.v1 + w * ac;
+    }
+
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0)
+    {
+        float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+        bary = glm::vec3(0, 1 - w, w);
+        return t.v2 + w * (t.v3 - t.v2);
+    }
+
+    float denom = 1.f / (va + vb + vc);
+    float v = vb * denom, w = vc * denom;
+    bary = glm::vec3(1 - v - w, v, w);
+    return t.v1 + ab * v + ac * w;
+}
+
+int MeshQuery::_trace(glm::vec3 ro, glm::vec3 rd, float maxDistance, bool firstOnly, MeshHit *hit) const
+{
+    if (empty())
+        return 0;
+
+    glm::vec3 invRd = 1.f / rd;
+    int numHits = 0;
+
+    unsigned int stack[MAX_STACK_DEPTH];
+    int stackSize = 0;
+    stack[stackSize++] = GetRootNodeID();
+    while (stackSize > 0)
+    {
+        unsigned int node = stack[--stackSize];
+        if (rayBox(ro, invRd, GetNodeBounds(node), maxDistance) < 0)
+            continue;
+
+        if (IsLeafNode(node))
+        {
+            const unsigned int *elements = GetNodeElements(node);
+            for (unsigned int i = 0; i < GetNodeElementCount(node); i++)
+            {
+                float distance;
+                glm::vec3 bary;
+                if (!rayTriangle(ro, rd, (*m_triangles)[elements[i]], distance, bary) ||
+                        distance <= 0 || distance > maxDistance)
+                    continue;
+
+                numHits++;
+                if (firstOnly)
+                {
+                    // Later nodes only matter if they are closer.
+                    maxDistance = distance;
+                    hit->triangle = elements[i];
+                    hit->distance = distance;
+                    hit->point = ro + distance * rd;
+                    hit->bary = bary;
+                }
+            }
+            continue;
+        }
+
+        // Push the farther child first, so the nearer one is searched first.
+        unsigned int child1, child2;
+        GetChildNodes(node, child1, child2);
+        float t1 = rayBox(ro, invRd, GetNodeBounds(child1), maxDistance);
+        float t2 = rayBox(ro, invRd, GetNodeBounds(child2), maxDistance);
+        if (t1 > t2)
+        {
+            std::swap(child1, child2);
+            std::swap(t1, t2);
+        }
+        if (t2 >= 0) stack[stackSize++] = child2;
+        if (t1 >= 0) stack[stackSize++] = child1;
+    }
+
+    return numHits;
+}
+
+bool MeshQuery::intersect(glm::vec3 ro, glm::vec3 rd, MeshHit &hit, float maxDistance) const
+{
+    hit.triangle = -1;
+    return _trace(ro, rd, maxDistance, true, &hit) > 0;
+}
+
+bool MeshQuery::contains(glm::vec3 p) const
+{
+    return _trace(p, CONTAINS_DIRECTION, std::numeric_limits<float>::max(), false, NULL) % 2 == 1;
+}
+
+bool MeshQuery::closestPoint(glm::vec3 p, MeshHit &hit, float maxDistance) const
+{
+    hit.triangle = -1;
+    if (empty())
+        return false;
+
+    float best2 = maxDistance * maxDistance; // Infinite for the default distance
+
+    unsigned int stack[MAX_STACK_DEPTH];
+    int stackSize = 0;
+    stack[stackSize++] = GetRootNodeID();
+    while (stackSize > 0)
+    {
+        unsigned int node = stack[--stackSize];
+        if (boxDistance2(p, GetNodeBounds(node)) > best2)
+            continue;
+
+        if (IsLeafNode(node))
+        {
+            const unsigned int *elements = GetNodeElements(node);
+            for (unsigned int i = 0; i < GetNodeElementCount(node); i++)
+            {
+                glm::vec3 bary;
+                glm::vec3 closest = closestPointOnTriangle(p, (*m_triangles)[elements[i]], bary);
+                float dist2 = glm::dot(closest - p, closest - p);
+                if (dist2 <= best2)
+                {
+                    best2 = dist2;
+                    hit.triangle = elements[i];
+                    hit.point = closest;
+                    hit.bary = bary;
+                }
+            }
+            continue;
+        }
+
+        unsigned int child1, child2;
+        GetChildNodes(node, child1, child2);
+        float d1 = boxDistance2(p, GetNodeBounds(child1));
+        float d2 = boxDistance2(p, GetNodeBounds(child2));
+        if (d1 > d2)
+        {
+            std::swap(child1, child2);
+            std::swap(d1, d2);
+        }
+        if (d2 <= best2) stack[stackSize++] = child2;
+        if (d1 <= best2) stack[stackSize++] = child1;
+    }
+
+    if (hit.triangle < 0)
+        return false;
+    hit.distance = sqrtf(best2);
+    return true;
+}
+
+void MeshQuery::trianglesInBox(glm::vec3 min, glm::vec3 max, std::vector<int> &result) const
+{
+    if (empty())
+        return;
+
+    float box[6] = { min.x, min.y, min.z, max.x, max.y, max.z };
+    unsigned int stack[MAX_STACK_DEPTH];
+    int stackSize = 0;
+    stack[stackSize++] = GetRootNodeID();
+    while (stackSize > 0)
+    {
+        unsigned int node = stack[--stackSize];
+        const float *b = GetNodeBounds(node);
+        if (b[0] > box[3] || b[1] > box[4] || b[2] > box[5] ||
+                b[3] < box[0] || b[4] < box[1] || b[5] < box[2])
+            continue;
+
+        if (IsLeafNode(node))
+        {
+            const unsigned int *elements = GetNodeElements(node);
+            for (unsigned int i = 0; i < GetNodeElementCount(node); i++)
+            {
+                float e[6];
+                GetElementBounds(elements[i], e);
+                if (e[0] <= box[3] && e[1] <= box[4] && e[2] <= box[5] &&
+                        e[3] >= box[0] && e[4] >= box[1] && e[5] >= box[2])
+                    result.push_back(elements[i]);
+            }
+            continue;
+        }
+
+        unsigned int child1, child2;
+        GetChildNodes(node, child1, child2);
+        stack[stackSize++] = child2;
+        stack[stackSize++] = child1;
+    }
+}
+
+void MeshQuery::intersect(const glm::vec3 *origins, const glm::vec3 *directions, int count, MeshHit *hits,
+                          ThreadPool *pool) const
+{
+    auto body = [&](int begin, int end)
+    {
+        for (int i = begin; i < end; i++)
+            intersect(origins[i], directions[i], hits[i]);
+    };
+    if (pool != NULL)
+        pool->parallelFor(count, QUERIES_PER_CHUNK, body);
+    else
+        body(0, count);
+}
+
+void MeshQuery::closestPoint(const glm::vec3 *points, int count, MeshHit *hits, float maxDistance,
+                             ThreadPool *pool) const
+{
+    auto body = [&](int begin, int end)
+    {
+        for (int i = begin; i < end; i++)
+            closestPoint(points[i], hits[i], maxDistance);
+    };
+    if (pool != NULL)
+        pool->parallelFor(count, QUERIES_PER_CHUNK, body);
+    else
+        body(0, count);
+}
+
+void MeshQuery::contains(const glm::vec3 *points, int count, bool *inside, ThreadPool *pool) const
+{
+    auto body = [&](int begin, int end)
+    {
+        for (int i = begin; i < end; i++)
+            inside[i] = contains(points[i]);
+    };
+    if (pool != NULL)
+        pool->parallelFor(count, QUERIES_PER_CHUNK, body);
+    else
+        body(0, count);
+}
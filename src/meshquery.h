@@ -0,0 +1,80 @@
+#ifndef MESHQUERY_H
+#define MESHQUERY_H
+
+#include "hairCommon.h"
+#include <cyBVH.h>
+#include <limits>
+
+class ThreadPool;
+
+// Where a query met the mesh. triangle is -1 if nothing was found.
+struct MeshHit
+{
+    int triangle;
+    float distance;   // Along the ray, or from the query point
+    glm::vec3 point;
+    glm::vec3 bary;   // Barycentric coordinates of point in the triangle
+
+    // Attributes of the triangle interpolated at the hit.
+    glm::vec3 normal(const Triangle &t) const { return bary.x * t.n1 + bary.y * t.n2 + bary.z * t.n3; }
+    glm::vec2 uv(const Triangle &t) const { return bary.x * t.uv1 + bary.y * t.uv2 + bary.z * t.uv3; }
+};
+
+/**
+ * Spatial queries against the triangles of a mesh, answered from the bounding
+ * volume hierarchy of cyCodeBase. Its nodes live in one flat array with both
+ * children of a node next to each other, and every query walks it with an
+ * explicit stack, nearer child first, skipping subtrees that cannot improve on
+ * the best result so far.
+ *
+ * The batched versions run one query per element, spread over a thread pool
+ * if one is given.
+ */
+class MeshQuery : public cy::BVH
+{
+public:
+    MeshQuery();
+
+    // Builds the hierarchy. The triangles must stay unchanged while it is in use.
+    void build(const std::vector<Triangle> *triangles);
+
+    bool empty() const;
+    const std::vector<Triangle> &triangles() const;
+    void bounds(glm::vec3 &min, glm::vec3 &max) const;
+
+    // First hit of the ray ro + t * rd for t in [0, maxDistance].
+    bool intersect(glm::vec3 ro, glm::vec3 rd, MeshHit &hit,
+                   float maxDistance = std::numeric_limits<float>::max()) const;
+
+    // Closest point of the mesh to p, if it is within maxDistance.
+    bool closestPoint(glm::vec3 p, MeshHit &hit,
+                      float maxDistance = std::numeric_limits<float>::max()) const;
+
+    // Whether p is enclosed by the mesh, by counting the crossings of a ray.
+    // Only meaningful for closed meshes.
+    bool contains(glm::vec3 p) const;
+
+    // Appends the triangles whose bounds overlap the box.
+    void trianglesInBox(glm::vec3 min, glm::vec3 max, std::vector<int> &result) const;
+
+    void intersect(const glm::vec3 *origins, const glm::vec3 *directions, int count, MeshHit *hits,
+                   ThreadPool *pool = NULL) const;
+    void closestPoint(const glm::vec3 *points, int count, MeshHit *hits,
+                      float maxDistance = std::numeric_limits<float>::max(), ThreadPool *pool = NULL) const;
+    void contains(const glm::vec3 *points, int count, bool *inside, ThreadPool *pool = NULL) const;
+
+    // Closest point to p on one triangle, and its barycentric coordinates.
+    static glm::vec3 closestPointOnTriangle(glm::vec3 p, const Triangle &t, glm::vec3 &bary);
+
+protected:
+    void GetElementBounds(unsigned int i, float box[6]) const;
+    float GetElementCenter(unsigned int i, int dimension) const;
+
+private:
+    // Number of hits of the ray within (0, maxDistance], or just the first one if firstOnly.
+    int _trace(glm::vec3 ro, glm::vec3 rd, float maxDistance, bool firstOnly, MeshHit *hit) const;
+
+    const std::vector<Triangle> *m_triangles;
+};
+
+#endif // MESHQUERY_H
@@ -0,0 +1,258 @@
+#include "meshsdf.h"
+
+#include "meshquery.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <deque>
+#include <limits>
+
+// Nodes per brick side
+#define BRICK_SIZE 8
+#define BRICK_NODES (BRICK_SIZE * BRICK_SIZE * BRICK_SIZE)
+
+#define BRICK_OUTSIDE -1
+#define BRICK_INSIDE -2
+
+MeshSDF::MeshSDF()
+{
+    m_cellSize = 0;
+    m_band = 0;
+}
+
+bool MeshSDF::empty() const
+{
+    return m_brickOffsets.empty();
+}
+
+void MeshSDF::build(const MeshQuery &query, int resolution, int bandCells)
+{
+    m_brickOffsets.clear();
+    m_brickData.clear();
+    if (query.empty())
+        return;
+
+    const std::vector<Triangle> &triangles = query.triangles();
+    glm::vec3 min, max;
+    query.bounds(min, max);
+
+    glm::vec3 extent = max - min;
+    m_cellSize = std::max(extent.x, std::max(extent.y, extent.z)) / resolution;
+    m_band = bandCells * m_cellSize;
+
+    // Leave a cell of outside around the band, so the border reads as outside.
+    m_origin = min - glm::vec3(m_band + m_cellSize);
+    m_numNodes = glm::ivec3(glm::ceil((extent + 2.f * glm::vec3(m_band + m_cellSize)) / m_cellSize)) + 1;
+    m_numBricks = (m_numNodes + BRICK_SIZE - 1) / BRICK_SIZE;
+    int numBricks = m_numBricks.x * m_numBricks.y * m_numBricks.z;
+
+    // A brick is in the band if the band of any triangle reaches one of its nodes.
+    ThreadPool *pool = ThreadPool::shared();
+    std::vector<std::vector<int> > brickTriangles(numBricks);
+    pool->parallelFor(numBricks, 16, [&](int begin, int end)
+    {
+        for (int brick = begin; brick < end; brick++)
+        {
+            glm::ivec3 brickNode = BRICK_SIZE * glm::ivec3(brick % m_numBricks.x,
+                                                           (brick / m_numBricks.x) % m_numBricks.y,
+                                                           brick / (m_numBricks.x * m_numBricks.y));
+            glm::vec3 brickMin = m_origin + m_cellSize * glm::vec3(brickNode);
+            glm::vec3 brickMax = brickMin + m_cellSize * (BRICK_SIZE - 1.f);
+            query.trianglesInBox(brickMin - m_band, brickMax + m_band, brickTriangles[brick]);
+        }
+    });
+
+    m_brickOffsets.assign(numBricks, BRICK_OUTSIDE);
+    std::vector<int> bandBricks;
+    for (int i = 0; i < numBricks; i++)
+    {
+        if (!brickTriangles[i].empty())
+        {
+            m_brickOffsets[i] = bandBricks.size() * BRICK_NODES;
+            bandBricks.push_back(i);
+        }
+    }
+    m_brickData.resize(bandBricks.size() * BRICK_NODES);
+
+    pool->parallelFor(bandBricks.size(), 1, [&](int begin, int end)
+    {
+        for (int b = begin; b < end; b++)
+        {
+            int brick = bandBricks[b];
+            glm::ivec3 brickNode = BRICK_SIZE * glm::ivec3(brick % m_numBricks.x,
+                                                           (brick / m_numBricks.x) % m_numBricks.y,
+                                                           brick / (m_numBricks.x * m_numBricks.y));
+            const std::vector<int> &candidates = brickTriangles[brick];
+
+            // Each triangle only updates the nodes within the band of its bounds.
+            float minDist2[BRICK_NODES];
+            float dist[BRICK_NODES];
+            std::fill(minDist2, minDist2 + BRICK_NODES, std::numeric_limits<float>::max());
+            for (unsigned int c = 0; c < candidates.size(); c++)
+            {
+                const Triangle &t = triangles[candidates[c]];
+                glm::vec3 tMin = glm::min(t.v1, glm::min(t.v2, t.v3)) - m_band;
+                glm::vec3 tMax = glm::max(t.v1, glm::max(t.v2, t.v3)) + m_band;
+                glm::ivec3 first = glm::ivec3(glm::ceil((tMin - m_origin) / m_cellSize)) - brickNode;
+                glm::ivec3 last = glm::ivec3(glm::floor((tMax - m_origin) / m_cellSize)) - brickNode;
+                first = glm::max(first, glm::ivec3(0));
+                last = glm::min(last, glm::ivec3(BRICK_SIZE - 1));
+                for (int z = first.z; z <= last.z; z++)
+                    for (int y = first.y; y <= last.y; y++)
+                        for (int x = first.x; x <= last.x; x++)
+                        {
+                            int i = (z * BRICK_SIZE + y) * BRICK_SIZE + x;
+                            glm::vec3 p = m_origin + m_cellSize * glm::vec3(brickNode + glm::ivec3(x, y, z));
+                            glm::vec3 bary;
+                            glm::vec3 closest = MeshQuery::closestPointOnTriangle(p, t, bary);
+                            float dist2 = glm::dot(p - closest, p - closest);
+                            if (dist2 < minDist2[i])
+                            {
+                                minDist2[i] = dist2;
+                                glm::vec3 normal = bary.x * t.n1 + bary.y * t.n2 + bary.z * t.n3;
+                                dist[i] = glm::dot(p - closest, normal) < 0 ? -sqrtf(dist2) : sqrtf(dist2);
+                            }
+                        }
+            }
+
+            // Nodes out of reach of every triangle are further than the band
+            // from the surface, and only need to know their side. They take it
+            // from a neighbouring node that has one.
+            int queue[BRICK_NODES];
+            int queueEnd = 0;
+            for (int i = 0; i < BRICK_NODES; i++)
+            {
+                if (minDist2[i] != std::numeric_limits<float>::max())
+                    queue[queueEnd++] = i;
+            }
+            if (queueEnd == 0)
+            {
+                glm::vec3 p = m_origin + m_cellSize * glm::vec3(brickNode);
+                MeshHit hit;
+                query.closestPoint(p, hit);
+                dist[0] = glm::dot(p - hit.point, hit.normal(triangles[hit.triangle])) < 0 ? -m_band : m_band;
+                minDist2[0] = 0;
+                queue[queueEnd++] = 0;
+            }
+            for (int q = 0; q < queueEnd; q++)
+            {
+                int i = queue[q];
+                int x = i % BRICK_SIZE, y = (i / BRICK_SIZE) % BRICK_SIZE, z = i / (BRICK_SIZE * BRICK_SIZE);
+                int neighbours[6] = { x > 0 ? i - 1 : -1, x < BRICK_SIZE - 1 ? i + 1 : -1,
+                                      y > 0 ? i - BRICK_SIZE : -1, y < BRICK_SIZE - 1 ? i + BRICK_SIZE : -1,
+                                      z > 0 ? i - BRICK_SIZE * BRICK_SIZE : -1,
+                                      z < BRICK_SIZE - 1 ? i + BRICK_SIZE * BRICK_SIZE : -1 };
+                for (int n = 0; n < 6; n++)
+                {
+                    int j = neighbours[n];
+                    if (j < 0 || minDist2[j] != std::numeric_limits<float>::max())
+                        continue;
+                    minDist2[j] = 0;
+                    dist[j] = dist[i] < 0 ? -m_band : m_band;
+                    queue[queueEnd++] = j;
+                }
+            }
+
+            float *data = &m_brickData[m_brickOffsets[brick]];
+            for (int i = 0; i < BRICK_NODES; i++)
+            {
+                data[i] = glm::clamp(dist[i], -m_band, m_band);
+            }
+        }
+    });
+
+    // Bricks away from the surface take the side of the band brick they are
+    // reached from first. Nodes on the facing side of a band brick are more
+    // than a cell from the surface, so they are on the same side as the
+    // neighbour as long as the band is at least a cell wide.
+    std::deque<int> queue(bandBricks.begin(), bandBricks.end());
+    std::vector<bool> reached(numBricks, false);
+    for (unsigned int i = 0; i < bandBricks.size(); i++)
+        reached[bandBricks[i]] = true;
+
+    glm::ivec3 offsets[6] = { glm::ivec3(-1, 0, 0), glm::ivec3(1, 0, 0), glm::ivec3(0, -1, 0),
+                              glm::ivec3(0, 1, 0), glm::ivec3(0, 0, -1), glm::ivec3(0, 0, 1) };
+    while (!queue.empty())
+    {
+        int brick = queue.front();
+        queue.pop_front();
+        glm::ivec3 b = glm::ivec3(brick % m_numBricks.x,
+                                  (brick / m_numBricks.x) % m_numBricks.y,
+                                  brick / (m_numBricks.x * m_numBricks.y));
+
+        for (int i = 0; i < 6; i++)
+        {
+            glm::ivec3 n = b + offsets[i];
+            if (glm::any(glm::lessThan(n, glm::ivec3(0))) || glm::any(glm::greaterThanEqual(n, m_numBricks)))
+                continue;
+            int neighbour = _brick(n.x, n.y, n.z);
+            if (reached[neighbour])
+                continue;
+            reached[neighbour] = true;
+
+            int side = m_brickOffsets[brick];
+            if (side >= 0)
+            {
+                // Middle node of the face towards the neighbour.
+                glm::ivec3 node = glm::clamp(BRICK_SIZE / 2 + offsets[i] * BRICK_SIZE, 0, BRICK_SIZE - 1);
+                float dist = m_brickData[side + (node.z * BRICK_SIZE + node.y) * BRICK_SIZE + node.x];
+                side = dist < 0 ? BRICK_INSIDE : BRICK_OUTSIDE;
+            }
+            m_brickOffsets[neighbour] = side;
+            queue.push_back(neighbour);
+        }
+    }
+
+    cout << "Mesh SDF: " << m_numNodes.x << "x" << m_numNodes.y << "x" << m_numNodes.z << " nodes, "
+         << bandBricks.size() << " of " << numBricks << " bricks in the band" << endl;
+}
+
+int MeshSDF::_brick(int x, int y, int z) const
+{
+    return (z * m_numBricks.y + y) * m_numBricks.x + x;
+}
+
+float MeshSDF::_node(int x, int y, int z) const
+{
+    int offset = m_brickOffsets[_brick(x / BRICK_SIZE, y / BRICK_SIZE, z / BRICK_SIZE)];
+    if (offset == BRICK_OUTSIDE)
+        return m_band;
+    if (offset == BRICK_INSIDE)
+        return -m_band;
+    x %= BRICK_SIZE;
+    y %= BRICK_SIZE;
+    z %= BRICK_SIZE;
+    return m_brickData[offset + (z * BRICK_SIZE + y) * BRICK_SIZE + x];
+}
+
+float MeshSDF::distance(glm::vec3 p, glm::vec3 &gradient) const
+{
+    glm::vec3 g = (p - m_origin) / m_cellSize;
+    if (empty() || glm::any(glm::lessThan(g, glm::vec3(0))) ||
+            glm::any(glm::greaterThanEqual(g, glm::vec3(m_numNodes - 1))))
+    {
+        gradient = glm::vec3(0);
+        return m_band;
+    }
+
+    glm::ivec3 i = glm::ivec3(g);
+    glm::vec3 f = g - glm::vec3(i);
+
+    float c000 = _node(i.x, i.y, i.z),         c100 = _node(i.x + 1, i.y, i.z);
+    float c010 = _node(i.x, i.y + 1, i.z),     c110 = _node(i.x + 1, i.y + 1, i.z);
+    float c001 = _node(i.x, i.y, i.z + 1),     c101 = _node(i.x + 1, i.y, i.z + 1);
+    float c011 = _node(i.x, i.y + 1, i.z + 1), c111 = _node(i.x + 1, i.y + 1, i.z + 1);
+
+    // Interpolate along x, then y, then z, keeping the derivatives of each step.
+    float c00 = glm::mix(c000, c100, f.x), c10 = glm::mix(c010, c110, f.x);
+    float c01 = glm::mix(c001, c101, f.x), c11 = glm::mix(c011, c111, f.x);
+    float c0 = glm::mix(c00, c10, f.y), c1 = glm::mix(c01, c11, f.y);
+
+    float dx00 = c100 - c000, dx10 = c110 - c010, dx01 = c101 - c001, dx11 = c111 - c011;
+    float dx0 = glm::mix(dx00, dx10, f.y), dx1 = glm::mix(dx01, dx11, f.y);
+
+    gradient.x = glm::mix(dx0, dx1, f.z) / m_cellSize;
+    gradient.y = glm::mix(c10 - c00, c11 - c01, f.z) / m_cellSize;
+    gradient.z = (c1 - c0) / m_cellSize;
+    return glm::mix(c0, c1, f.z);
+}
@@ -0,0 +1,51 @@
+#ifndef MESHSDF_H
+#define MESHSDF_H
+
+#include "hairCommon.h"
+
+class MeshQuery;
+
+/**
+ * Signed distance to a triangle mesh, negative inside, baked once onto a grid
+ * of nodes and read back with trilinear interpolation. The grid is stored in
+ * bricks of 8^3 nodes, and only bricks within the band of the surface
+ * keep their distances; every other brick is entirely inside or outside and
+ * reads as -band or +band. Lookups cost the same anywhere, independent of the
+ * number of triangles.
+ *
+ * Inside and outside are decided by the interpolated vertex normals at the
+ * closest point of the surface, so meshes that are not closed (e.g. a head cut
+ * off at the neck) still get a sensible sign near their surface.
+ */
+class MeshSDF
+{
+    friend class SceneCache;
+public:
+    MeshSDF();
+
+    // Bakes the distance to the triangles of query with resolution cells along
+    // the longest side of their bounds, exact up to bandCells cells from the surface.
+    void build(const MeshQuery &query, int resolution, int bandCells);
+
+    bool empty() const;
+
+    // Distance at p, and its gradient, which points away from the surface.
+    // Both are clamped to the band: far from the surface the gradient is zero.
+    float distance(glm::vec3 p, glm::vec3 &gradient) const;
+
+private:
+    float _node(int x, int y, int z) const;
+    int _brick(int x, int y, int z) const;
+
+    glm::vec3 m_origin;
+    float m_cellSize;
+    float m_band;
+    glm::ivec3 m_numNodes;
+    glm::ivec3 m_numBricks;
+
+    // Per brick: offset of its nodes in m_brickData, or BRICK_OUTSIDE / BRICK_INSIDE.
+    std::vector<int> m_brickOffsets;
+    std::vector<float> m_brickData;
+};
+
+#endif // MESHSDF_H
@@ -0,0 +1,168 @@
+#include "fluidgrid.h"
+
+#include <float.h>
+
+/*
+ * @file fluidgrid.cpp
+ *
+ * Dense voxel grid for the hair fluid (friction) model
+ */
+
+// Bounds memory if a few vertices fly off: vertices outside the grid are ignored.
+#define MAX_GRID_NODES 128
+
+FluidGrid::FluidGrid(float cellSize)
+{
+    m_cellSize = cellSize;
+    m_origin = glm::vec3(0.0);
+    m_dims = glm::ivec3(0);
+    m_allocations = 0;
+}
+
+void FluidGrid::reset(const glm::vec3 *positions, int count)
+{
+    glm::vec3 minPos = glm::vec3(FLT_MAX);
+    glm::vec3 maxPos = glm::vec3(-FLT_MAX);
+    for (int i = 0; i < count; ++i)
+    {
+        // Skip vertices the simulation has blown up.
+        if (!(glm::all(glm::lessThan(glm::abs(positions[i]), glm::vec3(FLT_MAX)))))
+            continue;
+        minPos = glm::min(minPos, positions[i]);
+        maxPos = glm::max(maxPos, positions[i]);
+    }
+
+    if (minPos.x > maxPos.x)
+    {
+        m_dims = glm::ivec3(0);
+    }
+    else
+    {
+        // Snap the origin to the cell size so cells line up from frame to frame.
+        m_origin = glm::floor(minPos / m_cellSize) * m_cellSize;
+        glm::ivec3 dims = glm::ivec3(glm::floor((maxPos - m_origin) / m_cellSize)) + 2;
+        m_dims = glm::min(dims, glm::ivec3(MAX_GRID_NODES));
+    }
+
+    _clear();
+}
+
+void FluidGrid::resetLike(const FluidGrid &other)
+{
+    m_cellSize = other.m_cellSize;
+    m_origin = other.m_origin;
+    m_dims = other.m_dims;
+    _clear();
+}
+
+void FluidGrid::_clear()
+{
+    // Only touched nodes can be nonzero, whatever layout they were written with.
+    for (unsigned int i = 0; i < m_touched.size(); ++i)
+    {
+        m_density[m_touched[i]] = 0.f;
+        m_momentum[m_touched[i]] = glm::vec3(0.0);
+    }
+    m_touched.clear();
+    m_allocations = 0;
+
+    unsigned int numNodes = m_dims.x * m_dims.y * m_dims.z;
+    if (numNodes > m_density.size())
+    {
+        m_density.resize(numNodes, 0.f);
+        m_momentum.resize(numNodes, glm::vec3(0.0));
+        m_allocations += 2;
+    }
+}
+
+void FluidGrid::_accumulate(int index, float density, glm::vec3 momentum)
+{
+    if (m_density[index] == 0.f)
+    {
+        if (m_touched.size() == m_touched.capacity())
+            m_allocations++;
+        m_touched.push_back(index);
+    }
+    m_density[index] += density;
+    m_momentum[index] += momentum;
+}
+
+void FluidGrid::add(const FluidGrid &other)
+{
+    for (unsigned int i = 0; i < other.m_touched.size(); ++i)
+    {
+        int index = other.m_touched[i];
+        _accumulate(index, other.m_density[index], other.m_momentum[index]);
+    }
+}
+
+bool FluidGrid::_locate(glm::vec3 position, glm::ivec3 &corner, glm::vec3 &fraction) const
+{
+    glm::vec3 gridPos = (position - m_origin) / m_cellSize;
+    glm::vec3 floorPos = glm::floor(gridPos);
+    if (glm::any(glm::lessThan(floorPos, glm::vec3(0.0))) ||
+        glm::any(glm::greaterThanEqual(floorPos, glm::vec3(m_dims - 1))))
+        return false;
+
+    corner = glm::ivec3(floorPos);
+    fraction = gridPos - floorPos;
+    return true;
+}
+
+void FluidGrid::splat(glm::vec3 position, glm::vec3 velocity)
+{
+    glm::ivec3 c;
+    glm::vec3 f;
+    if (!_locate(position, c, f))
+        return;
+
+    for (int i = 0; i < 8; ++i)
+    {
+        int dx = i & 1, dy = (i >> 1) & 1, dz = (i >> 2) & 1;
+        float weight = (dx ? f.x : 1.f - f.x) * (dy ? f.y : 1.f - f.y) * (dz ? f.z : 1.f - f.z);
+
+        // A zero weight would leave the node looking untouched after writing it.
+        if (weight > 0.f)
+            _accumulate(_index(c.x + dx, c.y + dy, c.z + dz), weight, weight * velocity);
+    }
+}
+
+glm::vec3 FluidGrid::velocity(glm::vec3 position) const
+{
+    glm::ivec3 c;
+    glm::vec3 f;
+    if (!_locate(position, c, f))
+        return glm::vec3(0.0);
+
+    // Interpolating momentum and density separately keeps empty nodes from
+    // dragging the average towards zero.
+    float density = 0;
+    glm::vec3 momentum = glm::vec3(0.0);
+    for (int i = 0; i < 8; ++i)
+    {
+        int dx = i & 1, dy = (i >> 1) & 1, dz = (i >> 2) & 1;
+        float weight = (dx ? f.x : 1.f - f.x) * (dy ? f.y : 1.f - f.y) * (dz ? f.z : 1.f - f.z);
+
+        int index = _index(c.x + dx, c.y + dy, c.z + dz);
+        density += weight * m_density[index];
+        momentum += weight * m_momentum[index];
+    }
+    return density > 0 ? momentum / density : glm::vec3(0.0);
+}
+
+float FluidGrid::density(glm::vec3 position) const
+{
+    glm::ivec3 c;
+    glm::vec3 f;
+    if (!_locate(position, c, f))
+        return 0;
+
+    float density = 0;
+    for (int i = 0; i < 8; ++i)
+    {
+        int dx = i & 1, dy = (i >> 1) & 1, dz = (i >> 2) & 1;
+        float weight = (dx ? f.x : 1.f - f.x) * (dy ? f.y : 1.f - f.y) * (dz ? f.z : 1.f - f.z);
+        density += weight * m_density[_index(c.x + dx, c.y + dy, c.z + dz)];
+    }
+    return density;
+}
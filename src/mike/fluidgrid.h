@@ -0,0 +1,75 @@
+#ifndef FLUIDGRID_H
+#define FLUIDGRID_H
+
+#include "hairCommon.h"
+
+/**
+ * @file fluidgrid.h
+ *
+ * Dense voxel grid used to treat the hair as a fluid for friction. Every frame
+ * the grid is fitted to the hair vertices, each vertex splats its velocity onto
+ * the 8 surrounding grid nodes with trilinear weights, and the averaged
+ * velocity is gathered back at any point with the same weights.
+ *
+ * The storage persists from frame to frame and only grows. Each grid remembers
+ * the nodes it has written since its last reset, so a reset only clears those
+ * and merging only visits them; once the grid has grown to fit the hair, steps
+ * do not touch the heap at all.
+ */
+class FluidGrid
+{
+public:
+    FluidGrid(float cellSize);
+
+    // Fits the grid around the given points and clears it.
+    void reset(const glm::vec3 *positions, int count);
+
+    // Takes the placement and size of another grid and clears this one.
+    void resetLike(const FluidGrid &other);
+
+    // Adds the nodes written in a grid with the same layout to this one, so
+    // partial grids splatted by separate threads can be merged.
+    void add(const FluidGrid &other);
+
+    // Nodes holding hair since the last reset.
+    int numTouched() const { return m_touched.size(); }
+
+    // Heap allocations made since the last reset.
+    int numAllocations() const { return m_allocations; }
+
+    // Adds a unit of density moving with the given velocity at position.
+    void splat(glm::vec3 position, glm::vec3 velocity);
+
+    // Density-weighted average velocity around position, zero where there is no hair.
+    glm::vec3 velocity(glm::vec3 position) const;
+
+    float density(glm::vec3 position) const;
+
+    float cellSize() const { return m_cellSize; }
+
+private:
+    // Finds the lowest corner of the cell containing position and the
+    // position inside that cell. Returns false outside the grid.
+    bool _locate(glm::vec3 position, glm::ivec3 &corner, glm::vec3 &fraction) const;
+
+    inline int _index(int x, int y, int z) const { return (z * m_dims.y + y) * m_dims.x + x; }
+
+    // Zeroes the touched nodes and makes room for the current layout.
+    void _clear();
+
+    // Accumulates into a node, remembering it the first time it gets hair.
+    void _accumulate(int index, float density, glm::vec3 momentum);
+
+    float m_cellSize;
+    glm::vec3 m_origin;
+    glm::ivec3 m_dims; // Number of grid nodes along each axis.
+
+    std::vector<float> m_density;
+    std::vector<glm::vec3> m_momentum;
+
+    // Nodes with nonzero density, in the order they were first written.
+    std::vector<int> m_touched;
+    int m_allocations;
+};
+
+#endif // FLUIDGRID_H
@@ -0,0 +1,111 @@
+#include "forcefield.h"
+
+#include "glm/gtc/noise.hpp"
+
+/*
+ * @file forcefield.cpp
+ *
+ * External force fields acting on the hair
+ */
+
+// Offsets between the noise lookups of the three gust components, so they are uncorrelated.
+#define NOISE_OFFSET_Y glm::vec3(31.7f, 0.0f, 0.0f)
+#define NOISE_OFFSET_Z glm::vec3(0.0f, 47.3f, 0.0f)
+
+UniformForce::UniformForce(glm::vec3 force)
+{
+    m_force = force;
+    m_objectForce = force;
+}
+
+void UniformForce::prepare(const ForceFrame &frame)
+{
+    m_objectForce = glm::vec3(frame.toObject * glm::vec4(m_force, 0.0));
+}
+
+void UniformForce::accumulate(const glm::vec3 *, glm::vec3 *forces, int count) const
+{
+    glm::vec3 force = m_objectForce;
+    for (int i = 0; i < count; ++i)
+    {
+        forces[i] += force;
+    }
+}
+
+NoiseWind::NoiseWind()
+{
+    m_direction = glm::vec3(1, 0, 0);
+    m_magnitude = 0.0f;
+    m_turbulence = 0.0f;
+    m_frequency = 1.0f;
+}
+
+void NoiseWind::prepare(const ForceFrame &frame)
+{
+    float length = glm::length(m_direction);
+    glm::vec3 direction = length > 0 ? m_direction / length : glm::vec3(0.0);
+
+    m_toWorld = frame.toWorld;
+    m_toObject = glm::mat3(frame.toObject);
+    m_objectForce = m_toObject * (direction * m_magnitude);
+
+    // The gusts travel with the wind, a unit of distance per second per unit of magnitude.
+    m_noiseOffset = direction * (m_magnitude * frame.time * m_frequency);
+}
+
+void NoiseWind::accumulate(const glm::vec3 *positions, glm::vec3 *forces, int count) const
+{
+    glm::vec3 force = m_objectForce;
+    if (m_turbulence == 0.0f || m_magnitude == 0.0f)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            forces[i] += force;
+        }
+        return;
+    }
+
+    // Gusts are sampled in world space so they stay put when the head turns.
+    glm::mat4 toNoise = glm::scale(glm::mat4(1.0), glm::vec3(m_frequency)) * m_toWorld;
+    glm::mat3 gustToObject = m_toObject * (m_magnitude * m_turbulence);
+    for (int i = 0; i < count; ++i)
+    {
+        glm::vec3 p = glm::vec3(toNoise * glm::vec4(positions[i], 1.0)) - m_noiseOffset;
+        glm::vec3 gust = glm::vec3(glm::simplex(p), glm::simplex(p + NOISE_OFFSET_Y), glm::simplex(p + NOISE_OFFSET_Z));
+        forces[i] += force + gustToObject * gust;
+    }
+}
+
+PointAttractor::PointAttractor(glm::vec3 position, float strength, float radius)
+{
+    m_position = position;
+    m_strength = strength;
+    m_radius = radius;
+    m_objectPosition = position;
+}
+
+void PointAttractor::prepare(const ForceFrame &frame)
+{
+    m_objectPosition = glm::vec3(frame.toObject * glm::vec4(m_position, 1.0));
+}
+
+void PointAttractor::accumulate(const glm::vec3 *positions, glm::vec3 *forces, int count) const
+{
+    if (m_radius <= 0.0f)
+        return;
+
+    glm::vec3 center = m_objectPosition;
+    float radiusSquared = m_radius * m_radius;
+    float invRadius = 1.0f / m_radius;
+    for (int i = 0; i < count; ++i)
+    {
+        glm::vec3 toward = center - positions[i];
+        float distanceSquared = glm::dot(toward, toward);
+        if (distanceSquared >= radiusSquared || distanceSquared == 0.0f)
+            continue;
+
+        // strength * (1 - d / radius) along the unit direction towards the point.
+        float distance = sqrtf(distanceSquared);
+        forces[i] += toward * (m_strength * (1.0f / distance - invRadius));
+    }
+}
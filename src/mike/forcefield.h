@@ -0,0 +1,95 @@
+#ifndef FORCEFIELD_H
+#define FORCEFIELD_H
+
+#include "hairCommon.h"
+
+/**
+ * @file forcefield.h
+ *
+ * External forces on the hair vertices. Fields are set up in world space and
+ * the hair is simulated in the object space of the head, so each step starts
+ * by handing every field the same ForceFrame; a field folds whatever does not
+ * depend on the vertex (directions, magnitudes, its own placement) into object
+ * space there, once. The per-vertex pass then only adds each field's force
+ * over a block of vertices in a tight loop, one field at a time.
+ */
+
+// Per-step constants shared by all fields.
+struct ForceFrame
+{
+    glm::mat4 toWorld;  // Object space of the hair to world space
+    glm::mat4 toObject; // World space to the object space of the hair
+    float time;         // Simulated seconds
+};
+
+class ForceField
+{
+public:
+    virtual ~ForceField() {}
+
+    // Called once per step, before any vertex is evaluated.
+    virtual void prepare(const ForceFrame &frame) = 0;
+
+    // Adds the object-space force on count vertices at the given object-space
+    // positions. Calls on disjoint blocks can run in parallel.
+    virtual void accumulate(const glm::vec3 *positions, glm::vec3 *forces, int count) const = 0;
+};
+
+/** The same world-space force everywhere, e.g. gravity. */
+class UniformForce : public ForceField
+{
+public:
+    UniformForce(glm::vec3 force = glm::vec3(0.0));
+
+    void prepare(const ForceFrame &frame);
+    void accumulate(const glm::vec3 *positions, glm::vec3 *forces, int count) const;
+
+    glm::vec3 m_force;
+
+private:
+    glm::vec3 m_objectForce;
+};
+
+/**
+ * Wind blowing along a direction, with gusts from simplex noise that drift
+ * with the wind. With no turbulence it is a uniform force and skips the noise.
+ */
+class NoiseWind : public ForceField
+{
+public:
+    NoiseWind();
+
+    void prepare(const ForceFrame &frame);
+    void accumulate(const glm::vec3 *positions, glm::vec3 *forces, int count) const;
+
+    glm::vec3 m_direction;
+    float m_magnitude;
+    float m_turbulence; // Size of the gusts relative to the magnitude
+    float m_frequency;  // Gusts per world unit
+
+private:
+    glm::mat4 m_toWorld;
+    glm::mat3 m_toObject;
+    glm::vec3 m_objectForce;
+    glm::vec3 m_noiseOffset;
+};
+
+/** Pulls vertices towards a point, fading out linearly to nothing at the radius. */
+class PointAttractor : public ForceField
+{
+public:
+    PointAttractor(glm::vec3 position, float strength, float radius);
+
+    void prepare(const ForceFrame &frame);
+    void accumulate(const glm::vec3 *positions, glm::vec3 *forces, int count) const;
+
+    glm::vec3 m_position;
+    float m_strength; // Negative to push away
+    float m_radius;
+
+private:
+    // The head only rotates and translates, so distances are the same in object space.
+    glm::vec3 m_objectPosition;
+};
+
+#endif // FORCEFIELD_H
@@ -0,0 +1,229 @@
+#include "guideskinning.h"
+
+#include "strandset.h"
+#include "threadpool.h"
+#include "pcgrandom.h"
+
+#include <cyPointCloud.h>
+#include <cySampleElim.h>
+
+#include <algorithm>
+
+/*
+ * @file guideskinning.cpp
+ *
+ * Guide selection and skinning of the rendered strands
+ */
+
+// Guides blended into each strand
+#define GUIDES_PER_STRAND 4
+
+// Weighted sample elimination picks the guides among this many random roots
+// per guide rather than among all of them, which is as even and much faster.
+#define CANDIDATES_PER_GUIDE 5
+
+// Roots measured to estimate the area of the scalp
+#define SPACING_SAMPLES 1024
+
+// Work handed to a pool thread at a time
+#define STRANDS_PER_CHUNK 64
+
+// Strand root in the form the cyCodeBase point cloud and sample elimination expect.
+struct RootPoint
+{
+    glm::vec3 p;
+
+    RootPoint() {}
+    RootPoint(glm::vec3 p) : p(p) {}
+
+    float &operator[](int i) { return p[i]; }
+    float operator[](int i) const { return p[i]; }
+    RootPoint operator-(const RootPoint &other) const { return RootPoint(p - other.p); }
+    float LengthSquared() const { return glm::dot(p, p); }
+};
+
+typedef cy::PointCloud<RootPoint, float, 3> RootCloud;
+
+GuideSkinning::GuideSkinning()
+{
+    m_identity = true;
+}
+
+void GuideSkinning::build(const StrandSet &strands, int numGuides, StrandSet &guides)
+{
+    int numStrands = strands.numStrands();
+    m_guides.clear();
+    m_weights.clear();
+
+    m_identity = numGuides >= numStrands;
+    if (m_identity)
+    {
+        m_guideStrands.resize(numStrands);
+        for (int i = 0; i < numStrands; ++i)
+            m_guideStrands[i] = i;
+        guides = strands;
+        return;
+    }
+
+    float spacing = _selectGuides(strands, std::max(numGuides, 1));
+
+    guides.clear();
+    std::vector<RootPoint> guideRoots(m_guideStrands.size());
+    for (unsigned int g = 0; g < m_guideStrands.size(); ++g)
+    {
+        int strand = m_guideStrands[g];
+        int first = strands.firstVertex(strand);
+        std::vector<glm::vec3> points(strands.m_startPositions.begin() + first,
+                                      strands.m_startPositions.begin() + first + strands.numVertices(strand));
+        guides.addStrand(points, strands.m_colors[strand],
+                         strands.m_triangleFaces[2 * strand], strands.m_triangleFaces[2 * strand + 1]);
+        guideRoots[g] = RootPoint(points[0]);
+    }
+
+    // Inverse squared distance weights of the nearest guide roots. A strand
+    // that is a guide itself only follows itself. Bounding the search keeps
+    // the k-d tree from visiting most of the guides for every strand.
+    RootCloud guideCloud(guideRoots.size(), guideRoots.data());
+    float searchRadius = 3.f * spacing;
+    m_guides.assign(numStrands * GUIDES_PER_STRAND, 0);
+    m_weights.assign(numStrands * GUIDES_PER_STRAND, 0.f);
+    for (int i = 0; i < numStrands; ++i)
+    {
+        RootCloud::PointInfo nearest[GUIDES_PER_STRAND];
+        RootPoint root = RootPoint(strands.m_startPositions[strands.firstVertex(i)]);
+        int found = guideCloud.GetPoints(root, searchRadius, GUIDES_PER_STRAND, nearest);
+        if (found == 0)
+            found = guideCloud.GetPoints(root, GUIDES_PER_STRAND, nearest);
+        std::sort(nearest, nearest + found);
+
+        int *guide = &m_guides[i * GUIDES_PER_STRAND];
+        float *weight = &m_weights[i * GUIDES_PER_STRAND];
+        if (found > 0 && nearest[0].distanceSquared == 0.f)
+            found = 1;
+
+        float total = 0;
+        for (int k = 0; k < found; ++k)
+        {
+            guide[k] = nearest[k].index;
+            weight[k] = found == 1 ? 1.f : 1.f / nearest[k].distanceSquared;
+            total += weight[k];
+        }
+        for (int k = 0; k < found; ++k)
+            weight[k] /= total;
+    }
+
+    cout << "Simulating " << guides.numStrands() << " guides for " << numStrands << " strands" << endl;
+}
+
+float GuideSkinning::_selectGuides(const StrandSet &strands, int numGuides)
+{
+    int numStrands = strands.numStrands();
+    std::vector<RootPoint> roots(numStrands);
+    for (int i = 0; i < numStrands; ++i)
+        roots[i] = RootPoint(strands.m_startPositions[strands.firstVertex(i)]);
+    RootCloud rootCloud(numStrands, roots.data());
+
+    // The roots cover the scalp, a surface, so the Poisson disk radius is set
+    // from its area rather than from the bounding box. For randomly placed
+    // roots the mean distance to the nearest one is half the square root of
+    // the area per root; a subset of the roots is enough to measure it.
+    int stride = std::max(numStrands / SPACING_SAMPLES, 1);
+    double rootSpacing = 0;
+    int numSamples = 0;
+    for (int i = 0; i < numStrands; i += stride)
+    {
+        RootCloud::PointInfo nearest[2];
+        int found = rootCloud.GetPoints(roots[i], 2, nearest);
+        if (found == 2)
+        {
+            rootSpacing += sqrt(std::max(nearest[0].distanceSquared, nearest[1].distanceSquared));
+            numSamples++;
+        }
+    }
+    rootSpacing /= std::max(numSamples, 1);
+    float area = 4.f * numStrands * rootSpacing * rootSpacing;
+
+    std::vector<RootPoint> candidates = roots;
+    if (numStrands > CANDIDATES_PER_GUIDE * numGuides)
+    {
+        // Fisher-Yates by hand: std::shuffle differs between standard libraries.
+        PcgRandom random(RANDOM_STREAM_GUIDES);
+        for (int i = candidates.size() - 1; i > 0; --i)
+            std::swap(candidates[i], candidates[random.bounded(i + 1)]);
+        candidates.resize(CANDIDATES_PER_GUIDE * numGuides);
+    }
+
+    cy::WeightedSampleElimination<RootPoint, float, 3> elimination;
+    float radius = 2.f * elimination.GetMaxPoissonDiskRadius(2, numGuides, area);
+    std::vector<RootPoint> selected(numGuides);
+    elimination.Eliminate(candidates.data(), candidates.size(), selected.data(), numGuides, false, radius, 2);
+
+    // Strands sharing a root could be picked twice; keep one of them.
+    std::vector<bool> picked(numStrands, false);
+    m_guideStrands.clear();
+    for (int g = 0; g < numGuides; ++g)
+    {
+        uint32_t strand;
+        if (rootCloud.GetClosestIndex(selected[g], strand) && !picked[strand])
+        {
+            picked[strand] = true;
+            m_guideStrands.push_back(strand);
+        }
+    }
+    std::sort(m_guideStrands.begin(), m_guideStrands.end());
+
+    return radius;
+}
+
+void GuideSkinning::skin(const StrandSet &strands, const StrandSet &guides, const std::vector<glm::vec3> &guidePositions,
+                         std::vector<glm::vec3> &positions, ThreadPool *pool) const
+{
+    if (m_identity)
+    {
+        positions = guidePositions;
+        return;
+    }
+
+    positions.resize(strands.numVertices());
+    const glm::vec3 *guideRest = guides.m_startPositions.data();
+    const glm::vec3 *guidePos = guidePositions.data();
+
+    auto skinStrands = [&](int begin, int end)
+    {
+        for (int i = begin; i < end; ++i)
+        {
+            int first = strands.firstVertex(i);
+            int count = strands.numVertices(i);
+            glm::vec3 *out = &positions[first];
+            std::copy(strands.m_startPositions.begin() + first, strands.m_startPositions.begin() + first + count, out);
+
+            // Vertex j takes the displacement of each guide at the same fraction of its length.
+            for (int k = 0; k < GUIDES_PER_STRAND; ++k)
+            {
+                float weight = m_weights[i * GUIDES_PER_STRAND + k];
+                if (weight == 0.f)
+                    continue;
+
+                int guide = m_guides[i * GUIDES_PER_STRAND + k];
+                int guideFirst = guides.firstVertex(guide);
+                int guideLast = guides.numVertices(guide) - 1;
+                float scale = count > 1 ? (float) guideLast / (count - 1) : 0.f;
+                for (int j = 0; j < count; ++j)
+                {
+                    float u = j * scale;
+                    int a = std::min((int) u, std::max(guideLast - 1, 0));
+                    int b = std::min(a + 1, guideLast);
+                    float f = u - a;
+                    glm::vec3 displacementA = guidePos[guideFirst + a] - guideRest[guideFirst + a];
+                    glm::vec3 displacementB = guidePos[guideFirst + b] - guideRest[guideFirst + b];
+                    out[j] += weight * glm::mix(displacementA, displacementB, f);
+                }
+            }
+        }
+    };
+
+    if (pool != NULL)
+        pool->parallelFor(strands.numStrands(), STRANDS_PER_CHUNK, skinStrands);
+    else
+        skinStrands(0, strands.numStrands());
+}
@@ -0,0 +1,49 @@
+#ifndef GUIDESKINNING_H
+#define GUIDESKINNING_H
+
+#include "hairCommon.h"
+
+class StrandSet;
+class ThreadPool;
+
+/**
+ * @file guideskinning.h
+ *
+ * Simulates a hair style through a subset of its strands. build() picks the
+ * guides with weighted sample elimination over the strand roots, so they
+ * spread evenly over the scalp, and weights every strand by its nearest
+ * guides. Each frame, skin() moves every strand by the weighted displacement
+ * of its guides from their rest shape, sampled at the same fraction of their
+ * length, so the whole style follows a simulation of only the guides.
+ */
+class GuideSkinning
+{
+public:
+    GuideSkinning();
+
+    // Fills guides with numGuides of the strands and computes the weights.
+    // Asking for at least as many guides as there are strands makes every
+    // strand its own guide.
+    void build(const StrandSet &strands, int numGuides, StrandSet &guides);
+
+    // Positions of all strands given the positions of the guides.
+    void skin(const StrandSet &strands, const StrandSet &guides, const std::vector<glm::vec3> &guidePositions,
+              std::vector<glm::vec3> &positions, ThreadPool *pool) const;
+
+    // Strand each guide was copied from.
+    const std::vector<int> &guideStrands() const { return m_guideStrands; }
+
+private:
+    // Picks the guides among the strand roots into m_guideStrands and returns
+    // the radius they are spread apart by.
+    float _selectGuides(const StrandSet &strands, int numGuides);
+
+    bool m_identity;
+    std::vector<int> m_guideStrands;
+
+    // GUIDES_PER_STRAND guides and weights per strand, weights summing to one.
+    std::vector<int> m_guides;
+    std::vector<float> m_weights;
+};
+
+#endif // GUIDESKINNING_H
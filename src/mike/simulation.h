@@ -2,108 +2,77 @@
 #define SIMULATION_H
 
 #include "hairCommon.h"
-#include "integrator.h"
 #include "objmesh.h"
-#include "md5.h"
+#include "fluidgrid.h"
+#include "forcefield.h"
 #include <QMap>
 #include <tuple>
 #include <iostream>
 #include <map>
 #include <string>
-
+#include <vector>
 #include <pthread.h>
 
 
 
 
 class HairObject;
-class Hair;
-class GLWidget;
-
-#define HAIRS_PER_THREAD 20
-
-
-struct fluid
-{
-    glm::vec3 velocity;
-    double    density;
-
-    fluid()
-    {
-        velocity = glm::vec3(0.0);
-        density = 0.0;
-    }
-
-    fluid(double d, glm::vec3 v)
-    {
-        velocity = v;
-        density = d;
-    }
-
-};
-
-struct grid_loc
-{
-    glm::vec3 pos;
-
-    grid_loc()
-    {
-        pos = glm::vec3(0.0);
-    }
-
-    grid_loc(glm::vec3 p)
-    {
-        pos = p;
-    }
-
-    bool operator==(const grid_loc &other) const
-    {
-        return (pos == other.pos);
-    }
-
-    bool operator<(const grid_loc &rhs) const {
-        return (glm::length(pos) < glm::length(rhs.pos));
-    }
-};
-
-struct grid_loc_hash
-{
-    std::size_t operator() (const grid_loc &key) const
-    {
-        QTime t;
-        t.start();
-        std::string s = md5(glm::to_string(key.pos));
-        const char *x = s.c_str();
-
-        size_t returnValue = htoi(x);
-        return returnValue;
-    }
-};
-
-struct HairSimulationThreadInfo {
-    Hair *hairs[HAIRS_PER_THREAD];
-
-//    QMap<std::tuple<double, double, double>, double> *densityGrid;
-//    QMap<std::tuple<double, double, double>, glm::vec3> *velocityGrid;
-    std::map<grid_loc, fluid> *fluidGrid;
-    float friction;
-
-};
+class StrandSet;
+class Renderer;
+class ThreadPool;
+class SimulationCache;
 
 
 class Simulation
 {
     friend class HairInterface;
 public:
-    Simulation(GLWidget *widget, ObjMesh *mesh, Simulation *_oldSim = NULL);
+    Simulation(Renderer *renderer, ObjMesh *mesh, Simulation *_oldSim = NULL);
     
     virtual ~Simulation();
     
     void update(float _time);
+
+    // Moves the simulation clock forward by frameTime seconds of wall time and
+    // returns the positions to draw, interpolated between the two latest
+    // solver states. The solver takes fixed steps of TIMESTEP / m_substeps,
+    // as many as fit into the elapsed time, either here or on its own thread
+    // when the renderer asks for one.
+    const std::vector<glm::vec3> &advance(HairObject *object, float frameTime);
+
+    // Waits for the simulation thread to finish its step and ends it. Must be
+    // called before the hair object it works on is deleted.
+    void stopThread();
+
+    // Takes one solver step of the current step size.
     void simulate(HairObject *_object);
     void updateHairPosition(HairObject *object);
     void updatePosition(HairObject *object, glm::vec3 xform);
     void updateRotation(HairObject *object, float angle, glm::vec3 axis);
+    // Jumps to a new transform without the hair feeling the head move.
+    void setTransform(HairObject *object, glm::mat4 xform);
+
+    // Heap allocations made building the fluid grid in the last step; zero
+    // once the grids have grown to fit the hair.
+    int numGridAllocations() const { return m_gridAllocations; }
+
+    // Adds a field on top of gravity and wind. The simulation takes ownership
+    // and passes its fields on to the simulation that replaces it.
+    void addForceField(ForceField *field);
+    void clearForceFields();
+
+    // Writes the SIMD width of the solver (int32) to filename, then appends
+    // the guide hair state after every solver step: the step number (int32),
+    // the simulated time (double), the vertex count (int32), then every
+    // position and every velocity as float triples. Deterministic runs of
+    // builds with the same SIMD width give identical files, to compare
+    // against golden ones.
+    bool dumpStates(const std::string &filename);
+
+    // Bakes the guide hair positions of object into a simulation cache, one
+    // frame per TIMESTEP of simulated time starting with the current state,
+    // until the simulation is deleted.
+    bool recordCache(HairObject *object, const std::string &filename);
     
     glm::mat4 m_xform;
     
@@ -117,44 +86,96 @@ private:
     void calculateFluidGrid(HairObject *_object);
     
     void calculateFrictionAndRepulsion(HairObject *_object);
-    static void* calculateFrictionAndRepulsionThread(void *untypedInfoStruct);
-    
-    static glm::vec3 gradient(std::map<grid_loc, fluid> &map, glm::vec3 pt);
-    
-    void integrate(HairObject *_object);
-    void integrate2(HairObject *_object);
-    void integrate3(HairObject *_object);
-    void integrate4(HairObject *_object);
     
     void particleSimulation(HairObject *obj);
+
+    // Takes one step of the given size and makes the result the newest state to draw.
+    void _step(HairObject *object, float timestep);
+
+    // Steps until the solver reaches the requested time.
+    void _catchUp(HairObject *object);
+
+    // Restarts the drawn states from the current positions of object.
+    void _resetStates(HairObject *object);
+
+    static void* _simulationThread(void *simulation);
+
+    // Writes the current guide hair state to the dump file.
+    void _dumpState(HairObject *object);
     
-    void insertFluid(std::map<grid_loc, fluid> &map, glm::vec3 pos, double density, glm::vec3 vel);
-    static fluid getFluid(std::map<grid_loc, fluid> &map, glm::vec3 pos);
-    static glm::vec3 getFluidVelocity(std::map<grid_loc, fluid> &map, glm::vec3 pos);
-    static double getFluidDensity(std::map<grid_loc, fluid> &map, glm::vec3 pos);
 
     
     
     
 public:
     QList<glm::vec3> m_externalForces;
-    std::map<grid_loc, fluid> m_fluidGrid;
+    FluidGrid m_fluidGrid;
     bool m_headMoving;
 
     glm::vec3 m_windDir;
     float m_windMagnitude;
+    float m_windTurbulence; // Gusts, relative to the wind magnitude
     float m_friction;
-    float m_stiffness;
+    float m_stiffness; // Bending towards the rest shape per TIMESTEP, from 0 to 1
+
+    // Solver steps per TIMESTEP. More, shorter steps keep stiff or fast hair stable.
+    int m_substeps;
+
+    // Reproducible mode: every frame takes exactly one TIMESTEP on the calling
+    // thread, whatever the wall time, and the fluid grid is split into the
+    // same blocks on any number of threads, so a run is the same bit for bit.
+    bool m_deterministic;
     
     
     
 private:
     float m_time;
-    GLWidget *m_widget;
+    Renderer *m_renderer;
     ObjMesh *m_mesh;
-        
-    pthread_t m_threads[200];
-    HairSimulationThreadInfo m_threadData[200];
+
+    // Worker threads shared by all simulation stages (ThreadPool::shared()).
+    ThreadPool *m_pool;
+
+    // One grid per block of vertices, splatted in parallel and then summed into m_fluidGrid.
+    std::vector<FluidGrid> m_partialGrids;
+
+    UniformForce m_gravity;
+    NoiseWind m_wind; // Follows m_windDir, m_windMagnitude and m_windTurbulence
+    std::vector<ForceField*> m_forceFields;
+
+    // Heap allocations made building the fluid grid in the last step.
+    int m_gridAllocations;
+
+    // Size of the step being taken, in simulated seconds.
+    float m_timestep;
+
+    // Held for a whole solver step, and by anything that changes the
+    // simulated state from another thread (e.g. moving the head).
+    pthread_mutex_t m_stepLock;
+
+    // Guards the clock, the drawn states and the thread controls below.
+    pthread_mutex_t m_lock;
+    pthread_cond_t m_wakeCond; // Signalled when the clock moves or the thread should quit.
+
+    // Simulated seconds requested by advance, and reached by the solver.
+    double m_targetTime, m_solvedTime;
+
+    // The two newest solver states (object space positions) and their times.
+    // Drawn positions lag one step behind the clock, so they always fall in between.
+    HairObject *m_stateObject;
+    std::vector<glm::vec3> m_prevState, m_currState;
+    double m_prevStateTime, m_currStateTime;
+    std::vector<glm::vec3> m_drawPositions;
+
+    pthread_t m_thread;
+    HairObject *m_threadObject; // NULL while no thread runs.
+    bool m_quit;
+
+    FILE *m_dumpFile; // NULL unless dumping states
+    int m_numSteps;
+
+    SimulationCache *m_cache; // NULL unless recording
+    double m_nextCacheTime;
     
 };
 
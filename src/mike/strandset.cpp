@@ -0,0 +1,129 @@
+#include "strandset.h"
+
+/*
+ * @file strandset.cpp
+ *
+ * Packed storage for the simulated guide hairs
+ */
+
+StrandSet::StrandSet()
+{
+}
+
+void StrandSet::clear()
+{
+    m_positions.clear();
+    m_velocities.clear();
+    m_forces.clear();
+    m_startPositions.clear();
+    m_prevPositions.clear();
+    m_restLengths.clear();
+    m_restDirections.clear();
+    m_rootDistances.clear();
+
+    m_firstVertex.clear();
+    m_numVertices.clear();
+    m_lengths.clear();
+    m_colors.clear();
+    m_triangleFaces.clear();
+}
+
+void StrandSet::reserve(int numStrands, int numVertices)
+{
+    m_positions.reserve(numVertices);
+    m_velocities.reserve(numVertices);
+    m_forces.reserve(numVertices);
+    m_startPositions.reserve(numVertices);
+    m_prevPositions.reserve(numVertices);
+    m_restLengths.reserve(numVertices);
+    m_restDirections.reserve(numVertices);
+    m_rootDistances.reserve(numVertices);
+
+    m_firstVertex.reserve(numStrands);
+    m_numVertices.reserve(numStrands);
+    m_lengths.reserve(numStrands);
+    m_colors.reserve(numStrands);
+    m_triangleFaces.reserve(2 * numStrands);
+}
+
+void StrandSet::resize(int numStrands, int numVertices)
+{
+    m_positions.resize(numVertices);
+    m_velocities.resize(numVertices);
+    m_forces.resize(numVertices);
+    m_startPositions.resize(numVertices);
+    m_prevPositions.resize(numVertices);
+    m_restLengths.resize(numVertices);
+    m_restDirections.resize(numVertices);
+    m_rootDistances.resize(numVertices);
+
+    m_firstVertex.resize(numStrands);
+    m_numVertices.resize(numStrands);
+    m_lengths.resize(numStrands);
+    m_colors.resize(numStrands);
+    m_triangleFaces.resize(2 * numStrands);
+}
+
+void StrandSet::finishStrand(int strand, glm::vec3 color, glm::vec3 triangleFace0, glm::vec3 triangleFace1)
+{
+    int first = m_firstVertex[strand];
+    int end = first + m_numVertices[strand];
+
+    float length = 0;
+    for (int i = first; i < end; ++i)
+    {
+        glm::vec3 position = m_positions[i];
+        m_startPositions[i] = position;
+        m_prevPositions[i] = position;
+        m_velocities[i] = glm::vec3(0.0);
+        m_forces[i] = glm::vec3(0.0);
+        m_rootDistances[i] = glm::length(position - m_positions[first]);
+
+        glm::vec3 segment = i + 1 < end ? m_positions[i + 1] - position : glm::vec3(0.0);
+        float segLen = glm::length(segment);
+        m_restLengths[i] = segLen;
+        m_restDirections[i] = segLen > 0 ? segment / segLen : glm::vec3(0.0);
+        length += segLen;
+    }
+
+    m_lengths[strand] = length;
+    m_colors[strand] = color;
+    m_triangleFaces[2 * strand] = triangleFace0;
+    m_triangleFaces[2 * strand + 1] = triangleFace1;
+}
+
+void StrandSet::addStrand(const std::vector<glm::vec3> &points, glm::vec3 color,
+                          glm::vec3 triangleFace0, glm::vec3 triangleFace1)
+{
+    int strand = numStrands();
+    int first = numVertices();
+    resize(strand + 1, first + points.size());
+
+    m_firstVertex[strand] = first;
+    m_numVertices[strand] = points.size();
+    std::copy(points.begin(), points.end(), m_positions.begin() + first);
+
+    finishStrand(strand, color, triangleFace0, triangleFace1);
+}
+
+void StrandSet::addStrand(int numSegments, float length, glm::vec3 root, glm::vec3 dir, glm::vec3 normal)
+{
+    if (numSegments < 1)
+        cerr << "Number of hair segments should be at least 1" << endl;
+
+    if (length <= 0)
+        cerr << "Hair length should be positive" << endl;
+
+    dir = glm::normalize(dir);
+
+    // Calculate basis vectors for plane orthogonal to dir.
+    glm::vec3 triangleFace0 = glm::normalize(glm::vec3(-normal.y, normal.x, 0));
+    glm::vec3 triangleFace1 = glm::cross(normal, triangleFace0);
+
+    float stepSize = length / numSegments;
+    std::vector<glm::vec3> points(numSegments + 1);
+    for (int i = 0; i < numSegments + 1; ++i)
+        points[i] = root + dir * (stepSize * i);
+
+    addStrand(points, glm::vec3(0.0), triangleFace0, triangleFace1);
+}
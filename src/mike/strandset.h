@@ -0,0 +1,65 @@
+#ifndef STRANDSET_H
+#define STRANDSET_H
+
+#include "hairCommon.h"
+
+/**
+ * @file strandset.h
+ *
+ * All guide hairs of a hair object, stored as a structure of arrays. Vertex
+ * attributes of every strand are packed back to back, so strand i owns the
+ * vertices [firstVertex(i), firstVertex(i) + numVertices(i)). The simulation
+ * walks the arrays it needs linearly, and the positions go to the GPU as is.
+ */
+class StrandSet
+{
+public:
+    StrandSet();
+
+    void clear();
+    void reserve(int numStrands, int numVertices);
+
+    // Sizes every array for numStrands strands and numVertices vertices in
+    // total, so loaders can fill the ranges and positions in place.
+    void resize(int numStrands, int numVertices);
+
+    // Derives the length, rest shape and simulation state of a strand whose
+    // range and positions are already filled in. Distinct strands can be
+    // finished from different threads.
+    void finishStrand(int strand, glm::vec3 color,
+                      glm::vec3 triangleFace0 = glm::vec3(0), glm::vec3 triangleFace1 = glm::vec3(0));
+
+    // Appends a strand through the given points, rooted at the first one.
+    void addStrand(const std::vector<glm::vec3> &points, glm::vec3 color,
+                   glm::vec3 triangleFace0 = glm::vec3(0), glm::vec3 triangleFace1 = glm::vec3(0));
+
+    // Appends a straight strand of numSegments equal segments growing from root along dir.
+    void addStrand(int numSegments, float length, glm::vec3 root, glm::vec3 dir, glm::vec3 normal);
+
+    inline int numStrands() const { return m_firstVertex.size(); }
+    inline int numVertices() const { return m_positions.size(); }
+    inline int firstVertex(int strand) const { return m_firstVertex[strand]; }
+    inline int numVertices(int strand) const { return m_numVertices[strand]; }
+
+    // Per-vertex state.
+    std::vector<glm::vec3> m_positions;
+    std::vector<glm::vec3> m_velocities;
+    std::vector<glm::vec3> m_forces;
+    std::vector<glm::vec3> m_startPositions;
+    std::vector<glm::vec3> m_prevPositions;
+
+    // Rest shape of the segment from each vertex to the next one (zero for the tip).
+    std::vector<float> m_restLengths;
+    std::vector<glm::vec3> m_restDirections;
+    // Straight line distance of each vertex from the root of its strand at rest.
+    std::vector<float> m_rootDistances;
+
+    // Per-strand data.
+    std::vector<int> m_firstVertex;
+    std::vector<int> m_numVertices;
+    std::vector<float> m_lengths;
+    std::vector<glm::vec3> m_colors;
+    std::vector<glm::vec3> m_triangleFaces; // Two basis vectors per strand for spreading interpolated hairs.
+};
+
+#endif // STRANDSET_H
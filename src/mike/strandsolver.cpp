@@ -0,0 +1,220 @@
+#include "strandsolver.h"
+
+#include "strandset.h"
+#include "simdfloat.h"
+
+#include <algorithm>
+
+/*
+ * @file strandsolver.cpp
+ *
+ * Lockstep SIMD strand solver
+ */
+
+// Velocity kept from one step to the next
+#define VELOCITY_DECAY 0.99f
+
+// Keeps the normalization finite for coincident vertices.
+#define MIN_SEGMENT_LENGTH_SQUARED 1e-20f
+
+// Keeps the rotation of the rest shape finite when a segment has turned
+// right around from its rest direction.
+#define MIN_ROTATION_DENOMINATOR 1e-4f
+
+// Three packs holding the x, y and z of one vector per lane.
+struct SimdVec3
+{
+    SimdFloat x, y, z;
+
+    SimdVec3() {}
+    SimdVec3(SimdFloat x, SimdFloat y, SimdFloat z) : x(x), y(y), z(z) {}
+};
+
+inline SimdVec3 operator+(const SimdVec3 &a, const SimdVec3 &b) { return SimdVec3(a.x + b.x, a.y + b.y, a.z + b.z); }
+inline SimdVec3 operator-(const SimdVec3 &a, const SimdVec3 &b) { return SimdVec3(a.x - b.x, a.y - b.y, a.z - b.z); }
+inline SimdVec3 operator*(const SimdVec3 &a, SimdFloat s) { return SimdVec3(a.x * s, a.y * s, a.z * s); }
+inline SimdFloat dot(const SimdVec3 &a, const SimdVec3 &b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline SimdVec3 cross(const SimdVec3 &a, const SimdVec3 &b)
+{
+    return SimdVec3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+}
+
+// Lanes are filled and emptied through small arrays: strands have different
+// lengths and start anywhere, so their vertices cannot be loaded as a block.
+struct LaneVec3
+{
+    float x[SIMD_WIDTH], y[SIMD_WIDTH], z[SIMD_WIDTH];
+
+    inline void set(int lane, const glm::vec3 &v) { x[lane] = v.x; y[lane] = v.y; z[lane] = v.z; }
+    inline glm::vec3 get(int lane) const { return glm::vec3(x[lane], y[lane], z[lane]); }
+
+    inline SimdVec3 load() const { return SimdVec3(SimdFloat::load(x), SimdFloat::load(y), SimdFloat::load(z)); }
+    inline void store(const SimdVec3 &v) { v.x.store(x); v.y.store(y); v.z.store(z); }
+};
+
+// 1 / sqrt(a), exactly or from the refined hardware estimate.
+template <bool exact>
+inline SimdFloat inverseSqrt(SimdFloat a)
+{
+    return exact ? rsqrtExact(a) : rsqrt(a);
+}
+
+StrandSolver::StrandSolver(float timestep, float mass, float dampening, bool exact)
+{
+    m_timestep = timestep;
+    m_mass = mass;
+    m_dampening = dampening;
+    m_exact = exact;
+}
+
+void StrandSolver::solve(StrandSet &strands, int beginStrand, int endStrand, float bending, float attachmentSlack) const
+{
+    if (m_exact)
+        _solve<true>(strands, beginStrand, endStrand, bending, attachmentSlack);
+    else
+        _solve<false>(strands, beginStrand, endStrand, bending, attachmentSlack);
+}
+
+template <bool exact>
+void StrandSolver::_solve(StrandSet &strands, int beginStrand, int endStrand, float bending, float attachmentSlack) const
+{
+    glm::vec3 *position = strands.m_positions.data();
+    glm::vec3 *velocity = strands.m_velocities.data();
+    glm::vec3 *forces = strands.m_forces.data();
+    const float *restLength = strands.m_restLengths.data();
+    const glm::vec3 *restDirection = strands.m_restDirections.data();
+    const float *rootDistance = strands.m_rootDistances.data();
+
+    const SimdFloat forceScale = 0.5f * m_timestep / m_mass;
+    const SimdFloat timestep = m_timestep;
+    const SimdFloat bend = bending;
+    const SimdFloat attachment = 1.f + attachmentSlack;
+    const SimdFloat one = 1.f;
+    const SimdFloat decay = VELOCITY_DECAY;
+    const SimdFloat invTimestep = 1.f / m_timestep;
+    const SimdFloat correctionScale = m_dampening / m_timestep;
+    const SimdFloat minLengthSquared = MIN_SEGMENT_LENGTH_SQUARED;
+    const SimdFloat minDenominator = MIN_ROTATION_DENOMINATOR;
+
+    for (int packet = beginStrand; packet < endStrand; packet += SIMD_WIDTH)
+    {
+        int first[SIMD_WIDTH], count[SIMD_WIDTH];
+        int maxCount = 0;
+        for (int lane = 0; lane < SIMD_WIDTH; ++lane)
+        {
+            int strand = packet + lane;
+            first[lane] = strand < endStrand ? strands.firstVertex(strand) : 0;
+            count[lane] = strand < endStrand ? strands.numVertices(strand) : 0;
+            maxCount = std::max(maxCount, count[lane]);
+        }
+
+        // Per lane: the projected and the original position of the previous
+        // vertex, and the velocity of the current one after the force update.
+        LaneVec3 lanePos, laneVel, laneForce, laneRestDir;
+        float laneRestLength[SIMD_WIDTH], laneRootDistance[SIMD_WIDTH];
+        for (int lane = 0; lane < SIMD_WIDTH; ++lane)
+        {
+            lanePos.set(lane, count[lane] > 0 ? position[first[lane]] : glm::vec3(0.0));
+            laneVel.set(lane, count[lane] > 0 ? velocity[first[lane]] : glm::vec3(0.0));
+            laneRestDir.set(lane, count[lane] > 0 ? restDirection[first[lane]] : glm::vec3(0.0));
+        }
+        SimdVec3 root = lanePos.load();
+        SimdVec3 prevProjected = root;
+        SimdVec3 prevPosition = prevProjected;
+        SimdVec3 prevVelocity = laneVel.load();
+
+        // Rest and current direction of the previous segment. The root is
+        // fixed to the head, so the first segment keeps its rest direction.
+        SimdVec3 prevRestDir = laneRestDir.load();
+        SimdVec3 prevDir = prevRestDir;
+
+        for (int j = 1; j <= maxCount; ++j)
+        {
+            for (int lane = 0; lane < SIMD_WIDTH; ++lane)
+            {
+                if (j < count[lane])
+                {
+                    int i = first[lane] + j;
+                    lanePos.set(lane, position[i]);
+                    laneVel.set(lane, velocity[i]);
+                    laneForce.set(lane, forces[i]);
+                    laneRestDir.set(lane, restDirection[i - 1]);
+                    laneRestLength[lane] = restLength[i - 1];
+                    laneRootDistance[lane] = rootDistance[i];
+                    forces[i] = glm::vec3(0.0);
+                }
+                else
+                {
+                    // Finished lanes compute garbage that is never stored.
+                    lanePos.set(lane, glm::vec3(0.0));
+                    laneVel.set(lane, glm::vec3(0.0));
+                    laneForce.set(lane, glm::vec3(0.0));
+                    laneRestDir.set(lane, glm::vec3(0.0));
+                    laneRestLength[lane] = 0.f;
+                    laneRootDistance[lane] = 0.f;
+                }
+            }
+
+            SimdVec3 pos = lanePos.load();
+            SimdVec3 restDir = laneRestDir.load();
+            SimdFloat length = SimdFloat::load(laneRestLength);
+
+            // Integrate.
+            SimdVec3 vel = laneVel.load() + laneForce.load() * forceScale;
+            SimdVec3 moved = pos + vel * timestep;
+            vel = vel * decay;
+
+            // Bending: turn the rest direction by the rotation from the rest
+            // to the current direction of the previous segment (Rodrigues'
+            // formula for the axis k = a x b, cos = a . b), and pull towards it.
+            SimdVec3 axis = cross(prevRestDir, prevDir);
+            SimdFloat cosine = dot(prevRestDir, prevDir);
+            SimdFloat invDenominator = inverseSqrt<exact>(max(one + cosine, minDenominator));
+            SimdVec3 restShape = restDir * cosine + cross(axis, restDir)
+                               + axis * (dot(axis, restDir) * invDenominator * invDenominator);
+            moved = moved + (prevProjected + restShape * length - moved) * bend;
+
+            // Long-range attachment: no farther from the root than at rest.
+            SimdVec3 fromRoot = moved - root;
+            SimdFloat maxDistance = SimdFloat::load(laneRootDistance) * attachment;
+            SimdFloat rootDistanceSquared = max(dot(fromRoot, fromRoot), minLengthSquared);
+            moved = root + fromRoot * min(one, maxDistance * inverseSqrt<exact>(rootDistanceSquared));
+
+            // Put the vertex back at its rest distance from the previous one.
+            SimdVec3 dir = moved - prevProjected;
+            SimdFloat invLength = inverseSqrt<exact>(max(dot(dir, dir), minLengthSquared));
+            SimdVec3 projected = prevProjected + dir * (invLength * length);
+            SimdVec3 correction = moved - projected;
+
+            // The previous vertex is final now: its velocity is how far it
+            // moved, plus the damped correction the current vertex needed.
+            SimdVec3 finalVelocity = (prevProjected - prevPosition) * invTimestep + correction * correctionScale;
+
+            LaneVec3 outPos, outVel, tailVel;
+            outPos.store(prevProjected);
+            outVel.store(finalVelocity);
+            tailVel.store(prevVelocity);
+            for (int lane = 0; lane < SIMD_WIDTH; ++lane)
+            {
+                int i = first[lane] + j - 1;
+                if (j < count[lane])
+                {
+                    position[i] = outPos.get(lane);
+                    velocity[i] = outVel.get(lane);
+                }
+                else if (j == count[lane])
+                {
+                    // The tip only takes its projected position.
+                    position[i] = outPos.get(lane);
+                    velocity[i] = tailVel.get(lane);
+                }
+            }
+
+            prevProjected = projected;
+            prevPosition = pos;
+            prevVelocity = vel;
+            prevRestDir = restDir;
+            prevDir = dir * invLength;
+        }
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef STRANDSOLVER_H
+#define STRANDSOLVER_H
+
+class StrandSet;
+
+/**
+ * @file strandsolver.h
+ *
+ * Follow-the-leader solver for the guide hairs. Every vertex is advanced by
+ * its velocity and forces, and then constrained from root to tip:
+ *
+ *  - bending pulls it towards the rest shape of its segment. The rest
+ *    direction is kept relative to the segment before it, turned by the
+ *    smallest rotation that takes that segment from its rest direction to
+ *    where it is now, so curls keep their shape wherever the strand swings;
+ *  - a long-range attachment keeps it within its rest distance from the
+ *    root (plus some slack), so a curl cannot be pulled straight even where
+ *    the bending is too weak to hold it;
+ *  - it is placed back at its rest distance from the vertex before it.
+ *
+ * The corrections feed back into the velocity (see DAMPENING in the solver).
+ *
+ * Strands are solved SIMD_WIDTH at a time in lockstep, one lane per strand,
+ * so the vertex-to-vertex dependency along a strand no longer serializes the
+ * work. The three passes of the original solver are fused into one sweep
+ * from root to tip.
+ */
+class StrandSolver
+{
+public:
+    // An exact solver avoids the hardware square root estimate, whose result
+    // differs between CPU vendors, so its steps reproduce bit for bit.
+    StrandSolver(float timestep, float mass, float dampening, bool exact = false);
+
+    // Advances the strands [beginStrand, endStrand) by one timestep. Bending is
+    // the fraction of the way to its rest shape each segment moves in the
+    // step; attachmentSlack how far beyond its rest distance from the root a
+    // vertex may go, relative to that distance. Calls on disjoint ranges can
+    // run in parallel.
+    void solve(StrandSet &strands, int beginStrand, int endStrand, float bending, float attachmentSlack) const;
+
+private:
+    template <bool exact>
+    void _solve(StrandSet &strands, int beginStrand, int endStrand, float bending, float attachmentSlack) const;
+
+    float m_timestep;
+    float m_mass;
+    float m_dampening;
+    bool m_exact;
+};
+
+#endif // STRANDSOLVER_H
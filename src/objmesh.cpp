@@ -6,42 +6,23 @@
 #include <glm/gtx/random.hpp>
 #include "QTime"
 
-#include "meshocttree.h"
+// Cells along the longest side of the mesh, and cells on either side of the
+// surface where collision distances are exact.
+#define SDF_RESOLUTION 128
+#define SDF_BAND_CELLS 3
 
-#define _ELLIPSOID_COLISIONS_ true
-
-extern float X_angle;
-extern float Y_angle;
-extern float Z_angle;
 ObjMesh::ObjMesh()
 {
 }
 
 void ObjMesh::init(const char *objFile, float scale)
 {
-    glm::mat4 transformation = glm::translate(glm::vec3(-0.0006 ,   1.7158 ,   0.0456)) *
-            glm::rotate(X_angle,glm::vec3(1,0,0)) *
-            glm::rotate(Y_angle,glm::vec3(0,1,0)) *
-            glm::rotate(Z_angle,glm::vec3(0,0,1)) *
-            glm::translate(glm::mat4(1.0f),glm::vec3(0.0006 ,   -1.7158 ,   -0.0456));
-
     if(strstr(objFile,".obj") || strstr(objFile,".OBJ")){
         std::vector<glm::vec3> vertices;
         std::vector<glm::vec2> uvs;
         std::vector<glm::vec3> normals;
         bool loaded = OBJLoader::loadOBJ(objFile, vertices, uvs, normals);
 
-        for(int i=0;i<vertices.size();++i){
-            glm::vec4 temp = transformation * glm::vec4(vertices[i],1.0);
-            vertices[i].x = temp.x;
-            vertices[i].y = temp.y;
-            vertices[i].z = temp.z;
-            glm::vec4 normtemp = transformation * glm::vec4(normals[i],1.0);
-            normals[i].x = normtemp.x;
-            normals[i].y = normtemp.y;
-            normals[i].z = normtemp.z;
-            normals[i]=glm::normalize(normals[i]);
-         }
         if (!loaded) {
             printf("Failed to load OBJ: %s\n", objFile);
             exit(1);
@@ -58,7 +39,8 @@ void ObjMesh::init(const char *objFile, float scale)
         }
 
         // Initialize vbo
-        std::vector<GLfloat> vboData;
+        std::vector<GLfloat> &vboData = m_vertexData;
+        m_vertexStride = 8;
         for (unsigned int i=0; i < vertices.size(); i++) {
             vboData.push_back(vertices[i].x);
             vboData.push_back(vertices[i].y);
@@ -74,11 +56,8 @@ void ObjMesh::init(const char *objFile, float scale)
             m_max = glm::max(m_max, scale * vertices[i]);
         }
 
-        m_shape.create();
-        m_shape.setVertexData(&vboData[0], sizeof(GLfloat) * vboData.size(), vertices.size());
-        m_shape.setAttribute(0, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 8, 0);
-        m_shape.setAttribute(1, 2, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 8, 3 * sizeof(GLfloat));
-        m_shape.setAttribute(2, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 8, 5 * sizeof(GLfloat));
+        _createShape();
+        _createQuery();
 
     }
     else
@@ -86,17 +65,6 @@ void ObjMesh::init(const char *objFile, float scale)
             bool normal = true,color = true;
             PlyModel plymodel;
             bool loaded = plymodel.loadPly(objFile,normal,color);
-            for(int i=0;i<plymodel.xyz.size();++i){
-                glm::vec4 temp = transformation * glm::vec4(plymodel.xyz[i],1.0);
-                plymodel.xyz[i].x = temp.x;
-                plymodel.xyz[i].y = temp.y;
-                plymodel.xyz[i].z = temp.z;
-                glm::vec4 normtemp = transformation * glm::vec4(plymodel.normals[i],1.0);
-                plymodel.normals[i].x = normtemp.x;
-                plymodel.normals[i].y = normtemp.y;
-                plymodel.normals[i].z = normtemp.z;
-                plymodel.normals[i]=glm::normalize(plymodel.normals[i]);
-            }
             plymodel.createBuffer();
           //  cout<<plymodel.xyz_buffer[0][0]<<","<<plymodel.xyz_buffer[0][1]<<","<<plymodel.xyz_buffer[0][2]<<endl;
           //  cout<<plymodel.xyz_buffer[1][0]<<","<<plymodel.xyz_buffer[1][1]<<","<<plymodel.xyz_buffer[1][2]<<endl;
@@ -119,7 +87,8 @@ void ObjMesh::init(const char *objFile, float scale)
             }
 
             // Initialize vbo
-            std::vector<GLfloat> vboData;
+            std::vector<GLfloat> &vboData = m_vertexData;
+            m_vertexStride = 11;
             for (unsigned int i=0; i < plymodel.xyz_buffer.size(); i++) {
                 vboData.push_back(plymodel.xyz_buffer[i][0]);
                 vboData.push_back(plymodel.xyz_buffer[i][1]);
@@ -138,12 +107,8 @@ void ObjMesh::init(const char *objFile, float scale)
                 m_max = glm::max(m_max, scale * plymodel.xyz_buffer[i]);
             }
 
-            m_shape.create();
-            m_shape.setVertexData(&vboData[0], sizeof(GLfloat) * vboData.size(), plymodel.xyz_buffer.size());
-            m_shape.setAttribute(0, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 11, 0);
-            m_shape.setAttribute(1, 2, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 11, 3 * sizeof(GLfloat));
-            m_shape.setAttribute(2, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 11, 5 * sizeof(GLfloat));
-            m_shape.setAttribute(3, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 11, 8 * sizeof(GLfloat));
+            _createShape();
+            _createQuery();
         }
         else{
             cerr<<"unknown mesh type."<<endl;
@@ -151,61 +116,76 @@ void ObjMesh::init(const char *objFile, float scale)
 
 }
 
-void ObjMesh::draw()
+void ObjMesh::init(const ObjMesh *source, float scale, const MeshSDF *field)
 {
-    m_shape.draw(GL_TRIANGLES);
+    // Grow the mesh in place: the head does not sit at the origin.
+    glm::vec3 center = 0.5f * (source->m_min + source->m_max);
+
+    triangles.clear();
+    triangles.reserve(source->triangles.size());
+    for (unsigned int i = 0; i < source->triangles.size(); i++) {
+        Triangle t = source->triangles[i];
+        t.v1 = center + (t.v1 - center) * scale;
+        t.v2 = center + (t.v2 - center) * scale;
+        t.v3 = center + (t.v3 - center) * scale;
+        triangles.push_back(t);
+    }
+
+    m_min = center + (source->m_min - center) * scale;
+    m_max = center + (source->m_max - center) * scale;
+
+    if (field != NULL)
+    {
+        _createQuery();
+        m_sdf = *field;
+    }
+    else
+        _createCollisionField();
 }
 
-/*
- * Shoot a ray from the point and if it intersects an even number of triangles, it is outside
- * If it intersects an odd number of triangles it is inside
- * TODO: Generate a random vector more elegantly
- */
-bool ObjMesh::contains(glm::vec3 &normal, glm::vec3 ro, float &insideDist)
+void ObjMesh::_createShape()
 {
-#if _ELLIPSOID_COLISIONS_
-#define _SQV_(v) glm::pow(v, glm::vec3(2.f))
-#define _SUM_(v) glm::dot(v, glm::vec3(1.f))
-
+    int stride = sizeof(GLfloat) * m_vertexStride;
+    m_shape.create();
+    m_shape.setVertexData(m_vertexData.data(), sizeof(GLfloat) * m_vertexData.size(), m_vertexData.size() / m_vertexStride);
+    m_shape.setAttribute(0, 3, GL_FLOAT, GL_FALSE, stride, 0);
+    m_shape.setAttribute(1, 2, GL_FLOAT, GL_FALSE, stride, 3 * sizeof(GLfloat));
+    m_shape.setAttribute(2, 3, GL_FLOAT, GL_FALSE, stride, 5 * sizeof(GLfloat));
+    if (m_vertexStride > 8)
+        m_shape.setAttribute(3, 3, GL_FLOAT, GL_FALSE, stride, 8 * sizeof(GLfloat));
+}
 
-    normal = glm::normalize(ro / _SQV_(m_max));
+void ObjMesh::_createQuery()
+{
+    m_query.build(&triangles);
+}
 
-    float phi = acos( glm::dot(normal, glm::vec3(0, 0, 1)) );
-    float theta = acos( glm::dot( glm::vec3(normal.x, normal.y, 0), glm::vec3(1, 0, 0) ) );
+void ObjMesh::_createCollisionField()
+{
+    _createQuery();
+    m_sdf.build(m_query, SDF_RESOLUTION, SDF_BAND_CELLS);
+}
 
-    glm::vec3 v = glm::vec3(cos(theta) * sin(phi), sin(theta) * cos(phi), cos(phi));
-    float r = 1.f / glm::sqrt(_SUM_(_SQV_( v / m_max )));
-    insideDist = r - glm::length(ro);
+const MeshQuery &ObjMesh::query() const
+{
+    return m_query;
+}
 
-    return _SUM_(_SQV_(ro/m_max)) < 1;
+void ObjMesh::draw()
+{
+    m_shape.draw(GL_TRIANGLES);
+}
 
-#undef _SUM_
-#undef _SQV_
-#else
-    // Return false if point is outside bounding cube.
-    if (glm::any(glm::lessThan(ro, m_min)) || glm::any(glm::greaterThan(ro, m_max)))
+bool ObjMesh::contains(glm::vec3 &normal, glm::vec3 ro, float &insideDist)
+{
+    glm::vec3 gradient;
+    float dist = m_sdf.distance(ro, gradient);
+    if (dist >= 0)
         return false;
 
-    int numIntersections = 0;
-    double rand1 = rand() % 1000; double rand2 = rand() % 1000; double rand3 = rand() % 1000;
-    glm::vec3 randDir = glm::normalize(glm::vec3(rand1, rand2, rand3));
-    randDir = glm::normalize(ro);
-
-//    OctTree, I think it works but not sure of performance
-//    QList<Triangle> reducedTriangles;
-//    m_octTree->getRelevantTriangles(reducedTriangles, ro, randDir);
-
-    for (unsigned int i = 0; i < triangles.size(); ++i)
-    {
-        Triangle currTriangle = triangles.at(i);
-        glm::vec3 intersectionPoint = glm::vec3(0.0);
-
-        if (currTriangle.intersect(intersectionPoint, ro, randDir))
-        {
-            normal = (currTriangle.n1 + currTriangle.n2 + currTriangle.n3) / 3.0f;
-            numIntersections++;
-        }
-    }
-    return (numIntersections % 2);
-#endif
+    // Deeper than the band the field is flat; push away from the middle instead.
+    float length = glm::length(gradient);
+    normal = length > 0 ? gradient / length : glm::normalize(ro - 0.5f * (m_min + m_max));
+    insideDist = -dist;
+    return true;
 }
@@ -3,14 +3,15 @@
 
 #include "hairCommon.h"
 #include "openglshape.h"
+#include "meshquery.h"
+#include "meshsdf.h"
 #include <QThread>
 #include <QtCore>
 #include <limits>
 
-class MeshOctTree;
-
 class ObjMesh : public QObject
 {
+    friend class SceneCache;
 public:
     ObjMesh();
 
@@ -20,15 +21,46 @@ public:
      */
     void init(const char * objFile, float scale = 1);
 
+    /**
+     * Initializes this mesh as a copy of an already loaded mesh, scaled about the
+     * center of its bounds, for collisions. Only the collision data is copied,
+     * so the result can be queried but not drawn.
+     * @param source Mesh to copy
+     * @param scale Factor by which to scale the mesh during computations (i.e. collision detection)
+     * @param field Distance field baked earlier for the same copy, e.g. by the scene cache; baked if NULL
+     */
+    void init(const ObjMesh *source, float scale, const MeshSDF *field = NULL);
+
     void draw();
 
+    // Whether ro is inside the mesh, and if so how deep and which way is out.
     bool contains(glm::vec3 &normal, glm::vec3 ro, float &insideDist);
 
+    // Ray, closest point and inside queries against the triangles.
+    const MeshQuery &query() const;
+
     std::vector<Triangle> triangles;
 
 private:
+    // Uploads m_vertexData to m_shape.
+    void _createShape();
+
+    // Builds m_query over the triangles.
+    void _createQuery();
+
+    // Builds m_query and bakes m_sdf from it. Only collision meshes need the field.
+    void _createCollisionField();
+
     OpenGLShape m_shape;
 
+    // Interleaved position, uv and normal, followed by a color for PLY meshes.
+    std::vector<GLfloat> m_vertexData;
+    int m_vertexStride = 0;
+
+    // Hierarchy over the (scaled) triangles, and the distance to them for collisions.
+    MeshQuery m_query;
+    MeshSDF m_sdf;
+
     glm::vec3 m_min = glm::vec3(std::numeric_limits<float>::max());
     glm::vec3 m_max = glm::vec3(std::numeric_limits<float>::min());
 
@@ -0,0 +1,219 @@
+#include "offscreencontext.h"
+#include "resourceloader.h"
+#include "errorchecker.h"
+#include "framebuffer.h"
+#include "texture.h"
+
+#include <QImage>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QSurfaceFormat>
+#include <cstring>
+
+#ifdef HAIR_EGL
+// Keep X11 out of the EGL headers, its macros clash with Qt.
+#define MESA_EGL_NO_X11_HEADERS
+#define EGL_NO_X11
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+OffscreenContext::OffscreenContext()
+{
+    target = NULL;
+    m_width = 0;
+    m_height = 0;
+    m_eglDisplay = NULL;
+    m_eglContext = NULL;
+    m_eglSurface = NULL;
+    m_surface = NULL;
+    m_qtContext = NULL;
+}
+
+OffscreenContext::~OffscreenContext()
+{
+    // GL objects have to be released while the context is current.
+    if (target != NULL)
+    {
+        makeCurrent();
+        safeDelete(target);
+    }
+    doneCurrent();
+
+#ifdef HAIR_EGL
+    if (m_eglContext != NULL)
+    {
+        eglDestroyContext(m_eglDisplay, m_eglContext);
+        if (m_eglSurface != NULL)
+            eglDestroySurface(m_eglDisplay, m_eglSurface);
+        eglTerminate(m_eglDisplay);
+    }
+#endif
+    safeDelete(m_qtContext);
+    safeDelete(m_surface);
+}
+
+bool OffscreenContext::create(int width, int height)
+{
+    m_width = width;
+    m_height = height;
+
+    if (!_createEGLContext() && !_createQtContext())
+    {
+        cerr << "Could not create an offscreen OpenGL 4.2 context." << endl;
+        return false;
+    }
+    ResourceLoader::initializeGlew();
+    cout << "Offscreen renderer: " << glGetString(GL_RENDERER) << endl;
+
+    target = new Framebuffer();
+    target->create();
+    target->generateColorTexture(m_width, m_height, GL_NEAREST, GL_NEAREST);
+    target->generateDepthBuffer(m_width, m_height);
+
+    ErrorChecker::printGLErrors("end of OffscreenContext::create");
+    return true;
+}
+
+bool OffscreenContext::_createEGLContext()
+{
+#ifdef HAIR_EGL
+    // Prefer Mesa's surfaceless platform, it works without X and without a GPU.
+    EGLDisplay display = EGL_NO_DISPLAY;
+    const char *clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+            (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (clientExtensions != NULL && strstr(clientExtensions, "EGL_MESA_platform_surfaceless") && getPlatformDisplay != NULL)
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if (display == EGL_NO_DISPLAY)
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint major, minor;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+    {
+        cerr << "EGL: could not initialize a display." << endl;
+        return false;
+    }
+
+    // The default surface type is a window, which surfaceless displays do not have.
+    const EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint numConfigs = 0;
+    if (!eglChooseConfig(display, configAttribs, &config, 1, &numConfigs) || numConfigs == 0)
+    {
+        cerr << "EGL: no OpenGL capable config." << endl;
+        eglTerminate(display);
+        return false;
+    }
+
+    eglBindAPI(EGL_OPENGL_API);
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION_KHR, 4,
+        EGL_CONTEXT_MINOR_VERSION_KHR, 2,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+        EGL_NONE
+    };
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+    if (context == EGL_NO_CONTEXT)
+    {
+        cerr << "EGL: could not create an OpenGL 4.2 core context." << endl;
+        eglTerminate(display);
+        return false;
+    }
+
+    // We only ever draw into framebuffer objects, so a surface is only needed
+    // when the driver cannot make a context current without one.
+    EGLSurface surface = EGL_NO_SURFACE;
+    const char *displayExtensions = eglQueryString(display, EGL_EXTENSIONS);
+    if (displayExtensions == NULL || !strstr(displayExtensions, "EGL_KHR_surfaceless_context"))
+    {
+        const EGLint pbufferAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        surface = eglCreatePbufferSurface(display, config, pbufferAttribs);
+    }
+
+    if (!eglMakeCurrent(display, surface, surface, context))
+    {
+        cerr << "EGL: could not make the context current." << endl;
+        eglDestroyContext(display, context);
+        if (surface != EGL_NO_SURFACE)
+            eglDestroySurface(display, surface);
+        eglTerminate(display);
+        return false;
+    }
+
+    m_eglDisplay = display;
+    m_eglContext = context;
+    m_eglSurface = surface;
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool OffscreenContext::_createQtContext()
+{
+    QSurfaceFormat format;
+    format.setVersion(4, 2);
+    format.setProfile(QSurfaceFormat::CoreProfile);
+
+    m_surface = new QOffscreenSurface();
+    m_surface->setFormat(format);
+    m_surface->create();
+
+    m_qtContext = new QOpenGLContext();
+    m_qtContext->setFormat(format);
+    if (!m_qtContext->create() || !m_qtContext->makeCurrent(m_surface))
+    {
+        safeDelete(m_qtContext);
+        safeDelete(m_surface);
+        return false;
+    }
+    return true;
+}
+
+void OffscreenContext::makeCurrent()
+{
+#ifdef HAIR_EGL
+    if (m_eglContext != NULL)
+        eglMakeCurrent(m_eglDisplay, m_eglSurface, m_eglSurface, m_eglContext);
+#endif
+    if (m_qtContext != NULL)
+        m_qtContext->makeCurrent(m_surface);
+}
+
+void OffscreenContext::doneCurrent()
+{
+#ifdef HAIR_EGL
+    if (m_eglContext != NULL)
+        eglMakeCurrent(m_eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+#endif
+    if (m_qtContext != NULL)
+        m_qtContext->doneCurrent();
+}
+
+void OffscreenContext::readPixels(QImage &image)
+{
+    image = QImage(m_width, m_height, QImage::Format_RGBX8888);
+
+    target->bind(GL_READ_FRAMEBUFFER);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, image.bits());
+    target->unbind(GL_READ_FRAMEBUFFER);
+
+    // OpenGL stores the bottom row first.
+    image = image.mirrored(false, true);
+}
+
+int OffscreenContext::width()
+{
+    return m_width;
+}
+
+int OffscreenContext::height()
+{
+    return m_height;
+}
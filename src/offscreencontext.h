@@ -0,0 +1,52 @@
+#ifndef OFFSCREENCONTEXT_H
+#define OFFSCREENCONTEXT_H
+
+#include "hairCommon.h"
+
+class Framebuffer;
+class QImage;
+class QOffscreenSurface;
+class QOpenGLContext;
+
+/**
+ * An OpenGL 4.2 core context without a window, plus a framebuffer of a fixed
+ * size to render into. When built with HAIR_EGL the context comes from a
+ * surfaceless EGL display, which needs no X server (Mesa llvmpipe is enough).
+ * Otherwise, or if EGL fails, it falls back to a Qt offscreen surface.
+ */
+class OffscreenContext
+{
+public:
+    OffscreenContext();
+    virtual ~OffscreenContext();
+
+    // Creates the context, makes it current and allocates the render target.
+    bool create(int width, int height);
+
+    void makeCurrent();
+    void doneCurrent();
+
+    // Copies the render target into image, top row first.
+    void readPixels(QImage &image);
+
+    int width();
+    int height();
+
+    Framebuffer *target;
+
+private:
+    bool _createEGLContext();
+    bool _createQtContext();
+
+    int m_width, m_height;
+
+    // EGL handles, kept opaque so EGL headers stay out of this file.
+    void *m_eglDisplay;
+    void *m_eglContext;
+    void *m_eglSurface;
+
+    QOffscreenSurface *m_surface;
+    QOpenGLContext *m_qtContext;
+};
+
+#endif // OFFSCREENCONTEXT_H
@@ -0,0 +1,788 @@
+#include "renderer.h"
+#include "resourceloader.h"
+#include "errorchecker.h"
+
+#include "hairobject.h"
+#include "simulation.h"
+#include "objmesh.h"
+#include "hairshaderprogram.h"
+#include "meshshaderprogram.h"
+#include "hairopacityshaderprogram.h"
+#include "whitehairshaderprogram.h"
+#include "whitemeshshaderprogram.h"
+#include "hairdepthpeelprogram.h"
+#include "meshdepthpeelprogram.h"
+#include "hairoitprogram.h"
+#include "oitcompositeshaderprogram.h"
+#include "texture.h"
+#include "framebuffer.h"
+#include "tessellator.h"
+#include "hairrendershaderprogram.h"
+#include "strandbuffer.h"
+#include "scenecache.h"
+#include "simulationcache.h"
+#include "quad.h"
+#include "hizbuffer.h"
+#include "meshdepthshaderprogram.h"
+
+#include <glm/gtx/color_space.hpp>
+
+// Size of the collision mesh relative to the head, so hair stays clear of its surface.
+#define COLLISION_SCALE 1.1f
+
+// Level of detail of the color passes: pixels per spline segment, and
+// interpolated hairs per pixel across a hair group.
+#define LOD_SEGMENT_LENGTH 4.f
+#define LOD_HAIR_DENSITY 2.f
+
+// Shadow and opacity maps only need the outline and overall density of the hair.
+#define SHADOW_LOD_SEGMENT_LENGTH 16.f
+#define SHADOW_LOD_HAIR_DENSITY 0.5f
+
+// Size of the occlusion culling depth pyramid. Coarse is enough to find the
+// clusters behind the head.
+#define HIZ_SIZE 512
+
+// Resolution of the hair shadow, mesh shadow and opacity maps. The light
+// frustum is fitted to the hair, so few of their texels miss it.
+#define SHADOW_MAP_SIZE 2048
+
+// Light frustum used while the light is inside the hair bounds.
+#define LIGHT_FOV 1.3f
+#define LIGHT_NEAR .1f
+#define LIGHT_FAR 100.f
+
+// Depth of all deep opacity map layers together, in units of the first (1 + 2 + 4 + 8).
+#define OPACITY_MAP_LAYER_UNITS 15.f
+
+Renderer::Renderer()
+{
+    m_highResMesh = NULL;
+    m_lowResMesh = NULL;
+    m_hairObject = NULL;
+    m_testSimulation = NULL;
+    m_playback = NULL;
+    m_playbackFrame = 0;
+
+    m_lightPosition = glm::vec3(0.0,2.3,2.0);
+
+    m_noiseTexture = new Texture();
+
+    // Shader programs
+    m_programs = {
+        m_hairProgram = new HairShaderProgram(),
+        m_meshProgram = new MeshShaderProgram(),
+        m_hairOpacityProgram = new HairOpacityShaderProgram(),
+        m_whiteHairProgram = new WhiteHairShaderProgram(),
+        m_whiteMeshProgram = new WhiteMeshShaderProgram(),
+        m_hairDepthPeelProgram = new HairDepthPeelShaderProgram(),
+        m_meshDepthPeelProgram = new MeshDepthPeelShaderProgram(),
+        m_hairOitProgram = new HairOitShaderProgram(),
+        m_oitCompositeProgram = new OitCompositeShaderProgram(),
+        m_meshDepthProgram = new MeshDepthShaderProgram(),
+
+        // TRANSFORM FEEDBACK
+        m_TFhairProgram = new HairRenderShaderProgram(),
+        m_TFwhiteHairProgram = new WhiteHairFeedbackShaderProgram(),
+        m_TFhairDepthPeelProgram = new HairFeedbackDepthPeelShaderProgram(),
+        m_TFhairOitProgram = new HairFeedbackOitShaderProgram(),
+        m_TFhairOpacityProgram = new HairFeedbackOpacityShaderProgram(),
+    };
+
+    // Framebuffers
+    m_framebuffers = {
+        m_hairShadowFramebuffer = new Framebuffer(),
+        m_meshShadowFramebuffer = new Framebuffer(),
+        m_opacityMapFramebuffer = new Framebuffer(),
+        m_finalFramebuffer = new Framebuffer(),
+        m_depthPeel0Framebuffer = new Framebuffer(),
+        m_depthPeel1Framebuffer = new Framebuffer(),
+        m_oitFramebuffer = new Framebuffer(),
+    };
+
+    m_tessellator = new Tessellator();
+    m_shadowTessellator = new Tessellator();
+    m_hiZBuffer = new HiZBuffer();
+    m_colorViewportHeight = 0;
+    m_opacityLayerSize = 0;
+    m_quad = new Quad();
+}
+
+Renderer::~Renderer()
+{
+    for (auto program = m_programs.begin(); program != m_programs.end(); ++program)
+        safeDelete(*program);
+    for (auto framebuffer = m_framebuffers.begin(); framebuffer != m_framebuffers.end(); ++framebuffer)
+        safeDelete(*framebuffer);
+
+    safeDelete(m_tessellator);
+    safeDelete(m_shadowTessellator);
+    safeDelete(m_hiZBuffer);
+    safeDelete(m_quad);
+    safeDelete(m_noiseTexture);
+    safeDelete(m_highResMesh);
+    safeDelete(m_lowResMesh);
+    safeDelete(m_testSimulation);
+    safeDelete(m_hairObject);
+    safeDelete(m_playback);
+}
+
+void Renderer::init(int width, int height)
+{
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_CULL_FACE);
+    glClearColor(0.5f, 0.5f, 0.5f, 0.0f);
+
+    // Initialize shader programs.
+    for (auto program = m_programs.begin(); program != m_programs.end(); ++program)
+        (*program)->create();
+
+    // Initialize textures.
+    m_noiseTexture->createColorTexture(":/images/noise128.jpg", GL_LINEAR, GL_LINEAR);
+
+    // Initialize framebuffers.
+    int shadowMapRes = SHADOW_MAP_SIZE;
+    glm::vec2 finalSize = glm::vec2(2 * width, 2 * height);
+    for (auto framebuffer = m_framebuffers.begin(); framebuffer != m_framebuffers.end(); ++framebuffer)
+        (*framebuffer)->create();
+    m_hairShadowFramebuffer->generateDepthTexture(shadowMapRes, shadowMapRes, GL_NEAREST, GL_NEAREST);
+    m_meshShadowFramebuffer->generateDepthTexture(shadowMapRes, shadowMapRes, GL_LINEAR, GL_LINEAR);
+    m_opacityMapFramebuffer->generateColorTexture(shadowMapRes, shadowMapRes, GL_NEAREST, GL_NEAREST);
+    m_opacityMapFramebuffer->generateDepthBuffer(shadowMapRes, shadowMapRes);
+    m_finalFramebuffer->generateColorTexture(finalSize.x, finalSize.y, GL_LINEAR, GL_LINEAR);
+    m_finalFramebuffer->generateDepthBuffer(finalSize.x, finalSize.y);
+    m_depthPeel0Framebuffer->generateColorTexture(finalSize.x, finalSize.y, GL_LINEAR, GL_LINEAR);
+    m_depthPeel0Framebuffer->generateDepthTexture(finalSize.x, finalSize.y, GL_NEAREST, GL_NEAREST);
+    m_depthPeel1Framebuffer->generateColorTexture(finalSize.x, finalSize.y, GL_LINEAR, GL_LINEAR);
+    m_depthPeel1Framebuffer->generateDepthBuffer(finalSize.x, finalSize.y);
+    m_oitFramebuffer->generateFloatColorTextures(2, finalSize.x, finalSize.y, GL_LINEAR, GL_LINEAR);
+    m_oitFramebuffer->attachDepthTexture(m_depthPeel0Framebuffer->depthTexture->id);
+    m_quad->init();
+    m_hiZBuffer->init(HIZ_SIZE);
+
+    ErrorChecker::printGLErrors("end of Renderer::init");
+}
+
+void Renderer::loadScene(const std::string &hairFile, const std::string &meshFile, bool reloadHair)
+{
+    bool meshChanged = m_highResMesh == NULL || meshFile != m_meshFile;
+    bool hairChanged = meshChanged || m_hairObject == NULL || hairFile != m_hairFile;
+
+    if (!hairChanged && !reloadHair)
+        return;
+
+    HairObject *_oldHairObject = m_hairObject;
+    QImage growthMap, groomingMap;
+    if (_oldHairObject == NULL){
+        growthMap = QImage(":/images/headHair.jpg");
+        groomingMap = QImage(growthMap.width(), growthMap.height(), growthMap.format());
+        groomingMap.fill(QColor(128, 128, 255));
+    } else {
+        growthMap = _oldHairObject->m_hairGrowthMap;
+        groomingMap = _oldHairObject->m_hairGroomingMap;
+    }
+
+    // Repeat loads of the same inputs skip parsing, transforming and blurring.
+    SceneCache cache(meshFile, hairFile, growthMap);
+    bool cached = cache.open();
+
+    if (meshChanged)
+    {
+        safeDelete(m_highResMesh);
+        safeDelete(m_lowResMesh);
+
+        m_highResMesh = new ObjMesh();
+        if (cached)
+            cache.restoreMesh(m_highResMesh);
+        else
+            m_highResMesh->init(meshFile.c_str()); //load head model
+        cout<<"load obj done."<<endl;
+
+        // The collision mesh is a scaled copy, so the model file is only parsed
+        // once, and only it needs the distance field, which the cache keeps.
+        MeshSDF field;
+        bool fieldCached = cached && cache.restoreCollisionField(field, COLLISION_SCALE);
+        m_lowResMesh = new ObjMesh();
+        m_lowResMesh->init(m_highResMesh, COLLISION_SCALE, fieldCached ? &field : NULL);
+
+        m_meshFile = meshFile;
+    }
+
+    Simulation *_oldSim = m_testSimulation;
+    m_testSimulation = new Simulation(this, m_lowResMesh, _oldSim);
+
+    m_hairObject = new HairObject(hairFile.c_str(), growthMap, groomingMap, m_testSimulation, _oldHairObject, cached ? &cache : NULL);
+
+    if (!cached)
+        cache.save(m_highResMesh, m_lowResMesh, COLLISION_SCALE,
+                   m_hairObject->m_renderHairs, m_hairObject->m_blurredHairGrowthMapTexture->m_image);
+
+    safeDelete(_oldSim);
+    safeDelete(_oldHairObject);
+
+    m_hairFile = hairFile;
+
+    _initTessellator();
+}
+
+void Renderer::setModelRotation(glm::vec3 angles)
+{
+    // Rotate about the center of the head, where the camera is aimed.
+    glm::vec3 center = glm::vec3(-0.0006, 1.7158, 0.0456);
+    glm::mat4 rotation = glm::translate(center) *
+            glm::rotate(angles.x, glm::vec3(1, 0, 0)) *
+            glm::rotate(angles.y, glm::vec3(0, 1, 0)) *
+            glm::rotate(angles.z, glm::vec3(0, 0, 1)) *
+            glm::translate(-center);
+    m_testSimulation->setTransform(m_hairObject, rotation);
+}
+
+void Renderer::setHairObject(HairObject *hairObject)
+{
+    if (hairObject == m_hairObject)
+        return;
+    if (m_testSimulation != NULL)
+        m_testSimulation->stopThread();
+    safeDelete(m_hairObject);
+    m_hairObject = hairObject;
+    _initTessellator();
+}
+
+void Renderer::_initTessellator()
+{
+    safeDelete(m_tessellator);
+    safeDelete(m_shadowTessellator);
+    m_tessellator = new Tessellator();
+    m_shadowTessellator = new Tessellator();
+    int numTriangles =
+            m_hairObject->m_renderHairs.numStrands() // # drawn strands
+            * m_hairObject->m_numGroupHairs         // # hairs per guide hair
+            * (m_hairObject->m_numSplineVertices-1) // # segments per hair
+            * 2;                                    // # triangles per segment
+
+    // With level of detail, few views need every strand in full. Both
+    // tessellations start at a fraction of that and grow as needed; render()
+    // reserves the full count when level of detail is off or when it is
+    // small enough (see Tessellator::setMaxTriangles).
+    m_tessellator->init(numTriangles / 4);
+    m_shadowTessellator->init(numTriangles / 4);
+}
+
+void Renderer::update(float time, float frameTime)
+{
+    if (m_playback != NULL)
+    {
+        showCachedFrame(m_playbackFrame);
+        m_playbackFrame = (m_playbackFrame + 1) % std::max(m_playback->numFrames(), 1);
+        return;
+    }
+
+    m_testSimulation->update(time);
+    m_hairObject->update(frameTime);
+}
+
+bool Renderer::playSimulationCache(const std::string &filename)
+{
+    if (m_playback != NULL && filename == m_playbackFile)
+        return true;
+
+    safeDelete(m_playback);
+    m_playback = new SimulationCache();
+    if (!m_playback->open(filename))
+    {
+        safeDelete(m_playback);
+        return false;
+    }
+    m_playbackFile = filename;
+    m_playbackFrame = 0;
+    return true;
+}
+
+bool Renderer::showCachedFrame(int frame)
+{
+    if (m_playback == NULL || !m_playback->frame(frame, m_playbackPositions))
+        return false;
+
+    // The guides are picked the same way every time, so a cache fits every load of its hair.
+    if ((int) m_playbackPositions.size() != m_hairObject->m_guideHairs.numVertices())
+    {
+        cerr << "Simulation cache has " << m_playbackPositions.size() << " guide vertices, the hair has "
+             << m_hairObject->m_guideHairs.numVertices() << endl;
+        return false;
+    }
+    m_hairObject->setGuidePositions(m_playbackPositions);
+    return true;
+}
+
+void Renderer::render(glm::mat4 view, glm::mat4 projection, int width, int height, Framebuffer *target)
+{
+    _resizeFramebuffers(width, height);
+
+    // Update transformation matrices.
+    glm::mat4 model = m_testSimulation->m_xform;
+    glm::mat4 lightView, lightProjection;
+    _fitLightFrustum(model, lightView, lightProjection);
+    m_eyeToLight = lightProjection * lightView * glm::inverse(view);
+
+    if (useCulling)
+        _buildHiZBuffer(model, view, projection);
+
+    // Bind textures.
+    m_noiseTexture->bind(GL_TEXTURE0);
+    m_hairShadowFramebuffer->depthTexture->bind(GL_TEXTURE1);
+    m_opacityMapFramebuffer->colorTexture->bind(GL_TEXTURE2);
+    m_meshShadowFramebuffer->depthTexture->bind(GL_TEXTURE3);
+    m_finalFramebuffer->colorTexture->bind(GL_TEXTURE4);
+    m_hairObject->m_blurredHairGrowthMapTexture->bind(GL_TEXTURE5);
+    m_depthPeel0Framebuffer->depthTexture->bind(GL_TEXTURE6);
+    m_depthPeel0Framebuffer->colorTexture->bind(GL_TEXTURE7);
+    m_depthPeel1Framebuffer->colorTexture->bind(GL_TEXTURE8);
+    m_hairObject->m_strandBuffer->bind(GL_TEXTURE9, GL_TEXTURE10, GL_TEXTURE11);
+    m_hairObject->m_strandBuffer->bindClusters(GL_TEXTURE14, GL_TEXTURE15);
+    m_hiZBuffer->bind(GL_TEXTURE16);
+
+    m_colorViewportHeight = useSupersampling ? 2 * height : height;
+
+    if (useTransformFeedback)
+    {
+        // Every strand in full is the most there can be. Without level of
+        // detail that is drawn, so make room for it up front; otherwise the
+        // tessellators grow as needed.
+        int maxTriangles =
+                m_hairObject->m_renderHairs.numStrands() // # drawn strands
+                * m_hairObject->m_numGroupHairs         // # hairs per guide hair
+                * (m_hairObject->m_numSplineVertices-1) // # segments per hair
+                * 2;                                    // # triangles per segment
+        m_tessellator->setMaxTriangles(maxTriangles);
+        m_shadowTessellator->setMaxTriangles(maxTriangles);
+        if (!useLevelOfDetail)
+        {
+            m_tessellator->reserve(maxTriangles);
+            m_shadowTessellator->reserve(maxTriangles);
+        }
+
+        // Tessellate once for the camera, and once more coarsely from the light.
+        // A tessellation that outgrew its buffer is redone in the grown one.
+        do
+        {
+            m_tessellator->beginTessellation();
+            _setLevelOfDetail(m_tessellator->program, false);
+            _setCulling(m_tessellator->program, false);
+            _drawHair(m_tessellator->program, model, view, projection, false);
+        } while (m_tessellator->endTessellation());
+
+        if (useShadows)
+        {
+            do
+            {
+                m_shadowTessellator->beginTessellation();
+                _setLevelOfDetail(m_shadowTessellator->program, true);
+                _setCulling(m_shadowTessellator->program, true);
+                _drawHair(m_shadowTessellator->program, model, lightView, lightProjection, false);
+            } while (m_shadowTessellator->endTessellation());
+        }
+    }
+
+    if (useShadows)
+    {
+        // Render hair shadow map.
+        m_hairShadowFramebuffer->bind();
+        glViewport(0, 0, m_hairShadowFramebuffer->depthTexture->width(), m_hairShadowFramebuffer->depthTexture->height());
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        _drawHairPass(m_whiteHairProgram, m_TFwhiteHairProgram, model, lightView, lightProjection, true);
+
+        // Render mesh shadow map.
+        m_meshShadowFramebuffer->bind();
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        //_drawMesh(m_whiteMeshProgram, model, lightView, lightProjection);
+
+        // Enable additive blending for opacity map.
+        glDisable(GL_DEPTH_TEST);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+        glBlendEquation(GL_FUNC_ADD);
+
+        // Render opacity map.
+        m_opacityMapFramebuffer->bind();
+        glViewport(0, 0, m_hairShadowFramebuffer->depthTexture->width(), m_hairShadowFramebuffer->depthTexture->height());
+        glClearColor(0.f, 0.f, 0.f, 0.f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        _drawHairPass(m_hairOpacityProgram, m_TFhairOpacityProgram, model, lightView, lightProjection, true);
+
+        // Restore previous state.
+        m_opacityMapFramebuffer->unbind();
+        glEnable(GL_DEPTH_TEST);
+        glDisable(GL_BLEND);
+
+    }
+
+    if (useTransparency && useBlendedTransparency)
+    {
+        _renderBlendedTransparency(model, view, projection, width, height, target);
+    }
+
+    else if (useTransparency)
+    {
+        _renderDepthPeeling(model, view, projection, width, height, target);
+    }
+
+    else
+    {
+        if (useSupersampling)
+        {
+            // Render into supersample framebuffer.
+            m_finalFramebuffer->bind();
+            glViewport(0, 0, m_finalFramebuffer->colorTexture->width(), m_finalFramebuffer->colorTexture->height());
+        }
+        else
+        {
+            // Render into the target framebuffer...
+            _bindTarget(target);
+            glViewport(0, 0, width, height);
+        }
+
+        // Render scene.
+        glClearColor(1.0f, 1.0f, 1.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        _drawHairPass(m_hairProgram, m_TFhairProgram, model, view, projection);
+        _drawMesh(m_meshProgram, model, view, projection);
+
+        if (useSupersampling)
+        {
+            // Render supersampled texture.
+            _bindTarget(target);
+            glViewport(0, 0, width, height);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            m_finalFramebuffer->colorTexture->renderFullScreen();
+        }
+    }
+
+    // Clean up.
+    m_noiseTexture->unbind(GL_TEXTURE0);
+    m_hairShadowFramebuffer->depthTexture->unbind(GL_TEXTURE1);
+    m_opacityMapFramebuffer->colorTexture->unbind(GL_TEXTURE2);
+    m_meshShadowFramebuffer->depthTexture->unbind(GL_TEXTURE3);
+    m_finalFramebuffer->colorTexture->unbind(GL_TEXTURE4);
+    m_hairObject->m_blurredHairGrowthMapTexture->unbind(GL_TEXTURE5);
+    m_depthPeel0Framebuffer->depthTexture->unbind(GL_TEXTURE6);
+    m_depthPeel0Framebuffer->colorTexture->unbind(GL_TEXTURE7);
+    m_depthPeel1Framebuffer->colorTexture->unbind(GL_TEXTURE8);
+    m_hairObject->m_strandBuffer->unbind(GL_TEXTURE9, GL_TEXTURE10, GL_TEXTURE11);
+    m_hairObject->m_strandBuffer->unbindClusters(GL_TEXTURE14, GL_TEXTURE15);
+    m_hiZBuffer->unbind(GL_TEXTURE16);
+}
+
+void Renderer::_bindTarget(Framebuffer *target)
+{
+    if (target != NULL)
+        target->bind();
+    else
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void Renderer::_resizeFramebuffers(int width, int height)
+{
+    Texture *finalTexture = m_finalFramebuffer->colorTexture;
+    if (finalTexture->width() != 2 * width || finalTexture->height() != 2 * height)
+    {
+        m_finalFramebuffer->colorTexture->resize(2 * width, 2 * height);
+        m_finalFramebuffer->resizeDepthBuffer(2 * width, 2 * height);
+    }
+
+    int w = useSupersampling ? 2 * width : width;
+    int h = useSupersampling ? 2 * height : height;
+
+    Texture *colorTexture0 = m_depthPeel0Framebuffer->colorTexture;
+    if (colorTexture0->width() != w || colorTexture0->height() != h)
+    {
+        m_depthPeel0Framebuffer->colorTexture->resize(w, h);
+        m_depthPeel0Framebuffer->depthTexture->resize(w, h);
+        m_depthPeel1Framebuffer->colorTexture->resize(w, h);
+        m_depthPeel1Framebuffer->resizeDepthBuffer(w, h);
+        m_oitFramebuffer->colorTextures[0]->resize(w, h);
+        m_oitFramebuffer->colorTextures[1]->resize(w, h);
+    }
+}
+
+void Renderer::_renderBlendedTransparency(glm::mat4 model, glm::mat4 view, glm::mat4 projection,
+                                          int width, int height, Framebuffer *target)
+{
+    glViewport(0, 0, m_depthPeel0Framebuffer->colorTexture->width(), m_depthPeel0Framebuffer->colorTexture->height());
+    glClearColor(1.0f, 1.0f, 1.0f, 0.0f);    //draw background
+
+    // Draw the opaque mesh.
+    m_depthPeel0Framebuffer->bind();
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    _drawMesh(m_meshProgram, model, view, projection);
+
+    // Accumulate every layer of hair at once. The hair is hidden by the mesh
+    // depth but does not write its own, so no layer hides another.
+    m_oitFramebuffer->bind();
+    GLfloat accumulationClear[] = {0.f, 0.f, 0.f, 0.f};
+    GLfloat revealageClear[] = {1.f, 1.f, 1.f, 1.f};
+    glClearBufferfv(GL_COLOR, 0, accumulationClear);
+    glClearBufferfv(GL_COLOR, 1, revealageClear);
+    glDepthMask(GL_FALSE);
+    glEnable(GL_BLEND);
+    glBlendEquation(GL_FUNC_ADD);
+    glBlendFunci(0, GL_ONE, GL_ONE);
+    glBlendFunci(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+    _drawHairPass(m_hairOitProgram, m_TFhairOitProgram, model, view, projection);
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+
+    // Render the mesh to the target.
+    _bindTarget(target);
+    glViewport(0, 0, width, height);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glDisable(GL_DEPTH_TEST);
+    m_depthPeel0Framebuffer->colorTexture->renderFullScreen();
+
+    // Blend the resolved hair on top, letting the mesh show through by the revealage.
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA);
+    m_oitFramebuffer->colorTextures[0]->bind(GL_TEXTURE12);
+    m_oitFramebuffer->colorTextures[1]->bind(GL_TEXTURE13);
+    m_oitCompositeProgram->bind();
+    m_oitCompositeProgram->uniforms.accumulationMap = 12;
+    m_oitCompositeProgram->uniforms.revealageMap = 13;
+    m_oitCompositeProgram->setGlobalUniforms();
+    m_quad->draw();
+    m_oitCompositeProgram->unbind();
+    m_oitFramebuffer->colorTextures[0]->unbind(GL_TEXTURE12);
+    m_oitFramebuffer->colorTextures[1]->unbind(GL_TEXTURE13);
+    glDisable(GL_BLEND);
+    glEnable(GL_DEPTH_TEST);
+}
+
+void Renderer::_renderDepthPeeling(glm::mat4 model, glm::mat4 view, glm::mat4 projection,
+                                   int width, int height, Framebuffer *target)
+{
+    glViewport(0, 0, m_depthPeel0Framebuffer->colorTexture->width(), m_depthPeel0Framebuffer->colorTexture->height());
+    glClearColor(1.0f, 1.0f, 1.0f, 0.0f);    //draw background
+
+    // Draw first (front-most) depth peeling layer.
+    m_depthPeel0Framebuffer->bind();
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    _drawHairPass(m_hairProgram, m_TFhairProgram, model, view, projection);
+    _drawMesh(m_meshProgram, model, view, projection);
+
+    // Draw second depth peeling layer.
+    m_depthPeel1Framebuffer->bind();
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    _drawHairPass(m_hairDepthPeelProgram, m_TFhairDepthPeelProgram, model, view, projection);
+    _drawMesh(m_meshDepthPeelProgram, model, view, projection);
+
+    // Render farthest layer to the target.
+    _bindTarget(target);
+    glViewport(0, 0, width, height);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glDisable(GL_DEPTH_TEST);
+    m_depthPeel1Framebuffer->colorTexture->renderFullScreen();
+
+    // Blend closer layers on top.
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    m_depthPeel0Framebuffer->colorTexture->renderFullScreen();
+    glDisable(GL_BLEND);
+    glEnable(GL_DEPTH_TEST);
+}
+
+void Renderer::_drawHair(ShaderProgram *program, glm::mat4 model, glm::mat4 view, glm::mat4 projection, bool bindProgram)
+{
+    if (bindProgram)
+    {
+        program->bind();
+    }
+    program->uniforms.noiseTexture = 0;
+    program->uniforms.hairShadowMap = 1;
+    program->uniforms.opacityMap = 2;
+    program->uniforms.meshShadowMap = 3;
+    program->uniforms.depthPeelMap = 6;
+    program->uniforms.strandVertices = 9;
+    program->uniforms.strandRanges = 10;
+    program->uniforms.strandData = 11;
+    program->uniforms.strandClusters = 14;
+    program->uniforms.clusterBounds = 15;
+    program->uniforms.hiZMap = 16;
+    program->uniforms.projection = projection;
+    program->uniforms.view = view;
+    program->uniforms.model = model;
+    program->uniforms.eyeToLight = m_eyeToLight;
+    program->uniforms.lightPosition = m_lightPosition;
+    program->uniforms.shadowIntensity = m_hairObject->m_shadowIntensity;
+    program->uniforms.opacityLayerSize = m_opacityLayerSize;
+    program->uniforms.useShadows = useShadows;
+    program->uniforms.specIntensity = m_hairObject->m_specularIntensity;
+    program->uniforms.diffuseIntensity = m_hairObject->m_diffuseIntensity;
+    program->uniforms.opacity = 1.f - m_hairObject->m_transparency;
+    if (m_hairObject->m_useHairColorVariation){
+        program->uniforms.maxColorVariation = m_hairObject->m_hairColorVariation;
+    } else {
+        program->uniforms.maxColorVariation = 0;
+    }
+    program->setGlobalUniforms();
+    m_hairObject->paint(program);
+}
+
+void Renderer::_drawHairPass(ShaderProgram *program, ShaderProgram *feedbackProgram,
+                             glm::mat4 model, glm::mat4 view, glm::mat4 projection, bool shadowPass)
+{
+    if (useTransformFeedback)
+    {
+        _drawHairFromFeedback(feedbackProgram, model, view, projection,
+                              shadowPass ? m_shadowTessellator : m_tessellator);
+    }
+    else
+    {
+        _setLevelOfDetail(program, shadowPass);
+        _setCulling(program, shadowPass);
+        _drawHair(program, model, view, projection);
+    }
+}
+
+void Renderer::_setLevelOfDetail(ShaderProgram *program, bool shadowPass)
+{
+    if (!useLevelOfDetail)
+    {
+        program->uniforms.lodSegmentLength = 0;
+        return;
+    }
+
+    if (shadowPass)
+    {
+        program->uniforms.lodViewportHeight = m_hairShadowFramebuffer->depthTexture->height();
+        program->uniforms.lodSegmentLength = SHADOW_LOD_SEGMENT_LENGTH;
+        program->uniforms.lodHairDensity = SHADOW_LOD_HAIR_DENSITY;
+    }
+    else
+    {
+        program->uniforms.lodViewportHeight = m_colorViewportHeight;
+        program->uniforms.lodSegmentLength = LOD_SEGMENT_LENGTH;
+        program->uniforms.lodHairDensity = LOD_HAIR_DENSITY;
+    }
+}
+
+void Renderer::_fitLightFrustum(glm::mat4 model, glm::mat4 &lightView, glm::mat4 &lightProjection)
+{
+    // Box around the interpolated hairs, which stray from the guide hairs.
+    glm::vec3 boxMin, boxMax;
+    m_hairObject->m_strandBuffer->bounds(boxMin, boxMax);
+    float margin = m_hairObject->m_hairGroupSpread + m_hairObject->m_noiseAmplitude + m_hairObject->m_hairRadius;
+    boxMin -= glm::vec3(margin);
+    boxMax += glm::vec3(margin);
+
+    glm::vec3 center = glm::vec3(model * glm::vec4(0.5f * (boxMin + boxMax), 1.f));
+    glm::vec3 direction = glm::normalize(center - m_lightPosition);
+    glm::vec3 up = fabs(direction.y) > 0.99f ? glm::vec3(0,0,1) : glm::vec3(0,1,0);
+    lightView = glm::lookAt(m_lightPosition, center, up);
+
+    // Extent of the box in light space: depth range and the slopes of the
+    // rays through its corners.
+    glm::mat4 toLight = lightView * model;
+    float nearPlane = FLT_MAX, farPlane = 0;
+    glm::vec2 slopeMin = glm::vec2(FLT_MAX), slopeMax = glm::vec2(-FLT_MAX);
+    for (int i = 0; i < 8; i++)
+    {
+        glm::vec3 corner = glm::vec3(i & 1 ? boxMax.x : boxMin.x,
+                                     i & 2 ? boxMax.y : boxMin.y,
+                                     i & 4 ? boxMax.z : boxMin.z);
+        glm::vec3 p = glm::vec3(toLight * glm::vec4(corner, 1.f));
+        float depth = -p.z;
+        nearPlane = std::min(nearPlane, depth);
+        farPlane = std::max(farPlane, depth);
+        glm::vec2 slope = glm::vec2(p) / std::max(depth, LIGHT_NEAR);
+        slopeMin = glm::min(slopeMin, slope);
+        slopeMax = glm::max(slopeMax, slope);
+    }
+
+    if (nearPlane < LIGHT_NEAR)
+    {
+        // The light is among the hair; nothing tight fits.
+        lightProjection = glm::perspective(LIGHT_FOV, 1.f, LIGHT_NEAR, LIGHT_FAR);
+        nearPlane = LIGHT_NEAR;
+        farPlane = std::max(farPlane, 2.f * LIGHT_NEAR);
+    }
+    else
+    {
+        lightProjection = glm::frustum(slopeMin.x * nearPlane, slopeMax.x * nearPlane,
+                                       slopeMin.y * nearPlane, slopeMax.y * nearPlane,
+                                       nearPlane, farPlane);
+    }
+
+    // Spread the opacity map layers over the depth of the hair.
+    glm::vec4 nearPoint = lightProjection * glm::vec4(0, 0, -nearPlane, 1);
+    glm::vec4 farPoint = lightProjection * glm::vec4(0, 0, -farPlane, 1);
+    float depthRange = 0.5f * (farPoint.z / farPoint.w - nearPoint.z / nearPoint.w);
+    m_opacityLayerSize = depthRange / OPACITY_MAP_LAYER_UNITS;
+}
+
+void Renderer::_setCulling(ShaderProgram *program, bool shadowPass)
+{
+    program->uniforms.useCulling = useCulling;
+    program->uniforms.useOcclusionCulling = useCulling && !shadowPass;
+}
+
+void Renderer::_buildHiZBuffer(glm::mat4 model, glm::mat4 view, glm::mat4 projection)
+{
+    // Only the head occludes; hair in front of it is not in the pyramid.
+    m_hiZBuffer->begin();
+    _drawMesh(m_meshDepthProgram, model, view, projection);
+    m_hiZBuffer->end();
+}
+
+void Renderer::_drawHairFromFeedback(ShaderProgram *program, glm::mat4 model, glm::mat4 view, glm::mat4 projection,
+                                     Tessellator *tessellator)
+{
+    program->bind();
+    program->uniforms.noiseTexture = 0;
+    program->uniforms.hairShadowMap = 1;
+    program->uniforms.opacityMap = 2;
+    program->uniforms.meshShadowMap = 3;
+    program->uniforms.depthPeelMap = 6;
+    program->uniforms.projection = projection;
+    program->uniforms.view = view;
+    program->uniforms.model = model;
+    program->uniforms.eyeToLight = m_eyeToLight;
+    program->uniforms.lightPosition = m_lightPosition;
+    program->uniforms.shadowIntensity = m_hairObject->m_shadowIntensity;
+    program->uniforms.opacityLayerSize = m_opacityLayerSize;
+    program->uniforms.useShadows = useShadows;
+    program->uniforms.specIntensity = m_hairObject->m_specularIntensity;
+    program->uniforms.diffuseIntensity = m_hairObject->m_diffuseIntensity;
+    program->uniforms.opacity = 1.f - m_hairObject->m_transparency;
+    program->uniforms.hairRadius = m_hairObject->m_hairRadius;
+    if (m_hairObject->m_useHairColorVariation){
+        program->uniforms.maxColorVariation = m_hairObject->m_hairColorVariation;
+    } else {
+        program->uniforms.maxColorVariation = 0;
+    }
+    program->setGlobalUniforms();
+    program->setPerObjectUniforms();
+    program->setPerDrawUniforms();
+    tessellator->draw();
+}
+
+void Renderer::_drawMesh(ShaderProgram *program, glm::mat4 model, glm::mat4 view, glm::mat4 projection)
+{
+    program->bind();
+    program->uniforms.hairShadowMap = 1;
+    program->uniforms.opacityMap = 2;
+    program->uniforms.meshShadowMap = 3;
+    program->uniforms.hairGrowthMap = 5;
+    program->uniforms.projection = projection;
+    program->uniforms.view = view;
+    program->uniforms.model = model;
+    program->uniforms.lightPosition = m_lightPosition;
+    program->uniforms.eyeToLight = m_eyeToLight;
+    program->uniforms.shadowIntensity = m_hairObject->m_shadowIntensity;
+    program->uniforms.opacityLayerSize = m_opacityLayerSize;
+    program->uniforms.useShadows = useShadows;
+    program->uniforms.color = 2.f * glm::rgbColor(glm::vec3(m_hairObject->m_color.x*255, m_hairObject->m_color.y, m_hairObject->m_color.z)); // multiplying by 2 because it looks better...
+    program->setGlobalUniforms();
+    program->setPerObjectUniforms();
+    m_highResMesh->draw();
+}
@@ -0,0 +1,179 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include "hairCommon.h"
+#include <string>
+
+class ObjMesh;
+class HairObject;
+class Simulation;
+class ShaderProgram;
+class Texture;
+class Framebuffer;
+class Tessellator;
+class SimulationCache;
+class Quad;
+class HiZBuffer;
+
+/**
+ * Owns everything needed to draw a frame: shader programs, framebuffers, the
+ * loaded head/hair assets and the simulation. It has no notion of a window, so
+ * the same instance can drive the interactive GLWidget or a headless batch run.
+ * All methods except the constructor require a current GL context.
+ */
+class Renderer
+{
+public:
+    Renderer();
+    virtual ~Renderer();
+
+    // Compiles shader programs and allocates framebuffers for the given output size.
+    void init(int width, int height);
+
+    // Loads the head mesh and hair style. Assets that are already loaded from the
+    // same files are reused; hair is always reloaded when reloadHair is set so
+    // the simulation restarts from the rest pose. Reloading the hair resets the
+    // model rotation.
+    void loadScene(const std::string &hairFile, const std::string &meshFile, bool reloadHair = false);
+
+    // Places the loaded head and hair rotated by the given angles (radians
+    // around x, then y, then z). Geometry stays as loaded; the rotation becomes
+    // the model transform of the render and the simulation.
+    void setModelRotation(glm::vec3 angles);
+
+    // Replaces the current hair object, e.g. after editing in the scene editor.
+    void setHairObject(HairObject *hairObject);
+
+    // Advances the simulation to the given time in seconds. frameTime is the
+    // wall time since the last update, which drives the simulation clock.
+    void update(float time, float frameTime);
+
+    // Plays the guide hair positions baked by Simulation::recordCache instead
+    // of simulating, one frame per update, looping.
+    bool playSimulationCache(const std::string &filename);
+
+    // Shows one frame of the cache being played.
+    bool showCachedFrame(int frame);
+
+    // Renders a frame into target, or into the default framebuffer if target is NULL.
+    void render(glm::mat4 view, glm::mat4 projection, int width, int height, Framebuffer *target = NULL);
+
+    bool useShadows = true;
+    bool useSupersampling = true;
+    bool useFrictionSim = true;
+    bool useSimulationThread = true; // Solve on a separate thread instead of in update.
+    bool useTransparency = true;
+    // Tessellates the hair once per frame and draws every pass from the result.
+    bool useTransformFeedback = true;
+    // Draws fewer interpolated hairs and spline segments for strands that
+    // cover little of the screen, and fewer still in the shadow passes.
+    bool useLevelOfDetail = true;
+    // Skips clusters of strands outside the view, and in the color passes
+    // those hidden behind the head.
+    bool useCulling = true;
+    // Blends every layer of transparent hair in a single pass (weighted
+    // blended transparency) instead of peeling the two front-most layers.
+    bool useBlendedTransparency = true;
+
+    ObjMesh *m_highResMesh, *m_lowResMesh;
+    HairObject *m_hairObject;
+    Simulation *m_testSimulation;
+
+    // Light parameters
+    glm::vec3 m_lightPosition;
+    glm::mat4 m_eyeToLight;
+
+private:
+    void _drawHair(ShaderProgram *program, glm::mat4 model, glm::mat4 view, glm::mat4 projection, bool bindProgram = true);
+    void _drawMesh(ShaderProgram *program, glm::mat4 model, glm::mat4 view, glm::mat4 projection);
+
+    void _drawHairFromFeedback(ShaderProgram *program, glm::mat4 model, glm::mat4 view, glm::mat4 projection,
+                               Tessellator *tessellator);
+
+    // Draws the hair with program, or with feedbackProgram from the tessellated
+    // triangles. Shadow passes use the coarser shadow level of detail.
+    void _drawHairPass(ShaderProgram *program, ShaderProgram *feedbackProgram,
+                       glm::mat4 model, glm::mat4 view, glm::mat4 projection, bool shadowPass = false);
+
+    // Sets the level of detail uniforms of a hair program for a color or a shadow pass.
+    void _setLevelOfDetail(ShaderProgram *program, bool shadowPass);
+
+    // Sets the culling uniforms of a hair program. Only color passes test
+    // against m_hiZBuffer, which is built from the camera.
+    void _setCulling(ShaderProgram *program, bool shadowPass);
+
+    // Points the light at the hair and fits its frustum, near and far planes
+    // included, around the hair bounds, so the shadow and opacity maps cover
+    // only the hair.
+    void _fitLightFrustum(glm::mat4 model, glm::mat4 &lightView, glm::mat4 &lightProjection);
+
+    // Draws the head into m_hiZBuffer from the camera.
+    void _buildHiZBuffer(glm::mat4 model, glm::mat4 view, glm::mat4 projection);
+
+    // Draws the hair once, blending all of its layers over the opaque mesh.
+    void _renderBlendedTransparency(glm::mat4 model, glm::mat4 view, glm::mat4 projection,
+                                    int width, int height, Framebuffer *target);
+
+    // Draws the two front-most layers of hair and mesh, one pass each, and blends them.
+    void _renderDepthPeeling(glm::mat4 model, glm::mat4 view, glm::mat4 projection,
+                             int width, int height, Framebuffer *target);
+
+    void _resizeFramebuffers(int width, int height);
+
+    void _bindTarget(Framebuffer *target);
+
+    void _initTessellator();
+
+    Tessellator *m_tessellator;
+    Tessellator *m_shadowTessellator; // Coarser, tessellated from the light
+
+    HiZBuffer *m_hiZBuffer; // Depth of the head, for occlusion culling
+
+    // Height in pixels of the buffer the color passes render into.
+    int m_colorViewportHeight;
+
+    // Light depth of the first deep opacity map layer, from _fitLightFrustum.
+    float m_opacityLayerSize;
+
+    Texture *m_noiseTexture;
+
+    std::vector<ShaderProgram*> m_programs;
+    ShaderProgram *m_hairProgram,
+                  *m_meshProgram,
+                  *m_hairOpacityProgram,
+                  *m_whiteMeshProgram,
+                  *m_whiteHairProgram,
+                  *m_hairDepthPeelProgram,
+                  *m_meshDepthPeelProgram,
+                  *m_hairOitProgram,
+                  *m_oitCompositeProgram,
+                  *m_meshDepthProgram,
+
+                  // TRANSFORM FEEDBACK
+                  *m_TFwhiteHairProgram,
+                  *m_TFhairDepthPeelProgram,
+                  *m_TFhairOitProgram,
+                  *m_TFhairOpacityProgram,
+                  *m_TFhairProgram;
+
+    std::vector<Framebuffer*> m_framebuffers;
+    Framebuffer *m_hairShadowFramebuffer,
+                *m_meshShadowFramebuffer,
+                *m_opacityMapFramebuffer,
+                *m_finalFramebuffer,
+                *m_depthPeel0Framebuffer,
+                *m_depthPeel1Framebuffer,
+                *m_oitFramebuffer; // Accumulation and revealage, sharing the depth of m_depthPeel0Framebuffer.
+
+    Quad *m_quad; // For full-screen passes
+
+    // Files the current assets were loaded from.
+    std::string m_hairFile, m_meshFile;
+
+    SimulationCache *m_playback; // NULL while simulating
+    std::string m_playbackFile;
+    int m_playbackFrame;
+    std::vector<glm::vec3> m_playbackPositions;
+};
+
+#endif // RENDERER_H
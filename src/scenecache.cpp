@@ -0,0 +1,312 @@
+#include "scenecache.h"
+
+#include "objmesh.h"
+#include "strandset.h"
+#include "hairloader.h"
+#include "mappedfile.h"
+#include "threadpool.h"
+#include "md5.h"
+#include "pcgrandom.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QImage>
+#include <QStandardPaths>
+#include <stdint.h>
+#include <algorithm>
+
+/*
+ * @file scenecache.cpp
+ *
+ * Binary cache of loaded scenes
+ */
+
+// Bump whenever the layout below or anything baked into it changes.
+#define CACHE_VERSION 4
+
+#define STRANDS_PER_CHUNK 256
+
+enum CacheSection
+{
+    MESH_VERTICES,
+    MESH_TRIANGLES,
+    SDF_BRICK_OFFSETS,
+    SDF_BRICK_DATA,
+    STRAND_FIRST_VERTICES,
+    STRAND_NUM_VERTICES,
+    STRAND_POSITIONS,
+    STRAND_COLORS,
+    GROWTH_MAP,
+    NUM_SECTIONS
+};
+
+struct SceneCacheHeader
+{
+    char magic[8];
+    uint32_t version;
+    char key[32];
+
+    int32_t meshStride;
+    glm::vec3 meshMin, meshMax;
+
+    // Distance field of the collision mesh (see MeshSDF)
+    float collisionScale;
+    glm::vec3 sdfOrigin;
+    float sdfCellSize, sdfBand;
+    glm::ivec3 sdfNumNodes, sdfNumBricks;
+
+    int32_t imageWidth, imageHeight, imageFormat, imageBytesPerLine;
+
+    // Byte ranges of the sections, relative to the start of the file.
+    uint64_t offsets[NUM_SECTIONS];
+    uint64_t sizes[NUM_SECTIONS];
+};
+
+static const char CACHE_MAGIC[8] = {'H', 'A', 'I', 'R', 'S', 'C', 'N', '\0'};
+
+static void hashFile(MD5 &hash, const std::string &filename)
+{
+    MappedFile file(filename.c_str());
+    uint64_t size = file.size();
+    hash.update((const char *) &size, sizeof(size));
+    if (file.valid())
+        hash.update(file.data(), file.size());
+}
+
+static std::string cacheDirectory()
+{
+    QByteArray dir = qgetenv("HAIR_CACHE_DIR");
+    if (!dir.isEmpty())
+        return dir.constData();
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation).toStdString();
+}
+
+SceneCache::SceneCache(const std::string &meshFile, const std::string &hairFile, const QImage &growthMap)
+{
+    m_file = NULL;
+
+    MD5 hash;
+    uint32_t version = CACHE_VERSION;
+    hash.update((const char *) &version, sizeof(version));
+    hashFile(hash, meshFile);
+    hashFile(hash, hairFile);
+    hashFile(hash, HairLoader::colorFilename(hairFile.c_str()));
+
+    // Strands without a color file get random colors, drawn from the seed.
+    uint64_t seed = PcgRandom::globalSeed();
+    hash.update((const char *) &seed, sizeof(seed));
+
+    int32_t imageInfo[3] = {growthMap.width(), growthMap.height(), growthMap.format()};
+    hash.update((const char *) imageInfo, sizeof(imageInfo));
+    for (int y = 0; y < growthMap.height(); ++y)
+        hash.update((const char *) growthMap.constScanLine(y), growthMap.bytesPerLine());
+
+    m_key = hash.finalize().hexdigest();
+
+    m_path = cacheDirectory() + "/" + m_key + ".scene";
+}
+
+SceneCache::~SceneCache()
+{
+    safeDelete(m_file);
+}
+
+bool SceneCache::open()
+{
+    safeDelete(m_file);
+    m_file = new MappedFile(m_path.c_str());
+    if (!m_file->valid())
+    {
+        safeDelete(m_file);
+        return false;
+    }
+
+    const SceneCacheHeader *header = (const SceneCacheHeader *) m_file->data();
+    bool valid = m_file->size() >= sizeof(SceneCacheHeader) &&
+            memcmp(header->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0 &&
+            header->version == CACHE_VERSION &&
+            m_key.compare(0, sizeof(header->key), header->key, sizeof(header->key)) == 0;
+    for (int i = 0; valid && i < NUM_SECTIONS; ++i)
+        valid = header->offsets[i] % sizeof(float) == 0 &&
+                header->sizes[i] <= m_file->size() &&
+                header->offsets[i] + header->sizes[i] <= m_file->size();
+
+    // The strand ranges are trusted from here on, so check that they stay
+    // within the positions.
+    uint64_t numStrands = valid ? header->sizes[STRAND_FIRST_VERTICES] / sizeof(int32_t) : 0;
+    uint64_t numVertices = valid ? header->sizes[STRAND_POSITIONS] / sizeof(glm::vec3) : 0;
+    valid = valid &&
+            header->meshStride > 0 &&
+            header->sizes[STRAND_FIRST_VERTICES] % sizeof(int32_t) == 0 &&
+            header->sizes[STRAND_NUM_VERTICES] == header->sizes[STRAND_FIRST_VERTICES] &&
+            header->sizes[STRAND_POSITIONS] % sizeof(glm::vec3) == 0 &&
+            header->sizes[STRAND_COLORS] == numStrands * sizeof(glm::vec3) &&
+            numVertices <= INT32_MAX &&
+            header->imageWidth >= 0 && header->imageHeight >= 0 && header->imageBytesPerLine >= 0 &&
+            header->sizes[GROWTH_MAP] >= (uint64_t) header->imageBytesPerLine * header->imageHeight;
+    const int32_t *firstVertices = valid ? (const int32_t *) _section(STRAND_FIRST_VERTICES) : NULL;
+    const int32_t *vertexCounts = valid ? (const int32_t *) _section(STRAND_NUM_VERTICES) : NULL;
+    for (uint64_t i = 0; valid && i < numStrands; ++i)
+        valid = firstVertices[i] >= 0 && vertexCounts[i] > 0 &&
+                (uint64_t) firstVertices[i] + vertexCounts[i] <= numVertices;
+
+    if (!valid)
+    {
+        cerr << "Ignoring invalid scene cache " << m_path << endl;
+        safeDelete(m_file);
+        return false;
+    }
+
+    cout << "Loading scene from cache " << m_path << endl;
+    return true;
+}
+
+const char* SceneCache::_section(int index)
+{
+    const SceneCacheHeader *header = (const SceneCacheHeader *) m_file->data();
+    return m_file->data() + header->offsets[index];
+}
+
+void SceneCache::restoreMesh(ObjMesh *mesh)
+{
+    const SceneCacheHeader *header = (const SceneCacheHeader *) m_file->data();
+
+    const GLfloat *vertices = (const GLfloat *) _section(MESH_VERTICES);
+    mesh->m_vertexData.assign(vertices, vertices + header->sizes[MESH_VERTICES] / sizeof(GLfloat));
+    mesh->m_vertexStride = header->meshStride;
+
+    const Triangle *triangles = (const Triangle *) _section(MESH_TRIANGLES);
+    mesh->triangles.assign(triangles, triangles + header->sizes[MESH_TRIANGLES] / sizeof(Triangle));
+
+    mesh->m_min = header->meshMin;
+    mesh->m_max = header->meshMax;
+
+    mesh->_createShape();
+    mesh->_createQuery();
+}
+
+bool SceneCache::restoreCollisionField(MeshSDF &field, float collisionScale)
+{
+    const SceneCacheHeader *header = (const SceneCacheHeader *) m_file->data();
+    if (header->collisionScale != collisionScale || header->sizes[SDF_BRICK_OFFSETS] == 0)
+        return false;
+
+    const int32_t *offsets = (const int32_t *) _section(SDF_BRICK_OFFSETS);
+    field.m_brickOffsets.assign(offsets, offsets + header->sizes[SDF_BRICK_OFFSETS] / sizeof(int32_t));
+    const float *data = (const float *) _section(SDF_BRICK_DATA);
+    field.m_brickData.assign(data, data + header->sizes[SDF_BRICK_DATA] / sizeof(float));
+    field.m_origin = header->sdfOrigin;
+    field.m_cellSize = header->sdfCellSize;
+    field.m_band = header->sdfBand;
+    field.m_numNodes = header->sdfNumNodes;
+    field.m_numBricks = header->sdfNumBricks;
+    return true;
+}
+
+void SceneCache::restoreHair(StrandSet &strands, QImage &blurredGrowthMap)
+{
+    const SceneCacheHeader *header = (const SceneCacheHeader *) m_file->data();
+
+    int numStrands = header->sizes[STRAND_FIRST_VERTICES] / sizeof(int32_t);
+    int numVertices = header->sizes[STRAND_POSITIONS] / sizeof(glm::vec3);
+    strands.clear();
+    strands.resize(numStrands, numVertices);
+    memcpy(strands.m_firstVertex.data(), _section(STRAND_FIRST_VERTICES), numStrands * sizeof(int32_t));
+    memcpy(strands.m_numVertices.data(), _section(STRAND_NUM_VERTICES), numStrands * sizeof(int32_t));
+    memcpy((void *) strands.m_positions.data(), _section(STRAND_POSITIONS), numVertices * sizeof(glm::vec3));
+    const glm::vec3 *colors = (const glm::vec3 *) _section(STRAND_COLORS);
+
+    // The rest shape is cheap to derive, so only the positions are stored.
+    ThreadPool::shared()->parallelFor(numStrands, STRANDS_PER_CHUNK, [&](int begin, int end)
+    {
+        for (int i = begin; i < end; ++i)
+            strands.finishStrand(i, colors[i]);
+    });
+
+    QImage image(header->imageWidth, header->imageHeight, (QImage::Format) header->imageFormat);
+    const char *pixels = _section(GROWTH_MAP);
+    int lineSize = std::min(header->imageBytesPerLine, image.bytesPerLine());
+    for (int y = 0; y < image.height(); ++y)
+        memcpy(image.scanLine(y), pixels + y * header->imageBytesPerLine, lineSize);
+    blurredGrowthMap = image;
+}
+
+bool SceneCache::save(const ObjMesh *mesh, const ObjMesh *collisionMesh, float collisionScale,
+                      const StrandSet &strands, const QImage &blurredGrowthMap)
+{
+    if (!QDir().mkpath(QString::fromStdString(cacheDirectory())))
+    {
+        cerr << "Could not create scene cache directory " << cacheDirectory() << endl;
+        return false;
+    }
+
+    SceneCacheHeader header;
+    memset((void *) &header, 0, sizeof(header));
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    memcpy(header.key, m_key.data(), std::min(m_key.size(), sizeof(header.key)));
+    header.meshStride = mesh->m_vertexStride;
+    header.meshMin = mesh->m_min;
+    header.meshMax = mesh->m_max;
+    const MeshSDF &field = collisionMesh->m_sdf;
+    header.collisionScale = collisionScale;
+    header.sdfOrigin = field.m_origin;
+    header.sdfCellSize = field.m_cellSize;
+    header.sdfBand = field.m_band;
+    header.sdfNumNodes = field.m_numNodes;
+    header.sdfNumBricks = field.m_numBricks;
+    header.imageWidth = blurredGrowthMap.width();
+    header.imageHeight = blurredGrowthMap.height();
+    header.imageFormat = blurredGrowthMap.format();
+    header.imageBytesPerLine = blurredGrowthMap.bytesPerLine();
+
+    const void *data[NUM_SECTIONS] = {
+        mesh->m_vertexData.data(),
+        mesh->triangles.data(),
+        field.m_brickOffsets.data(),
+        field.m_brickData.data(),
+        strands.m_firstVertex.data(),
+        strands.m_numVertices.data(),
+        strands.m_positions.data(),
+        strands.m_colors.data(),
+        blurredGrowthMap.constBits(),
+    };
+    header.sizes[MESH_VERTICES] = mesh->m_vertexData.size() * sizeof(GLfloat);
+    header.sizes[MESH_TRIANGLES] = mesh->triangles.size() * sizeof(Triangle);
+    header.sizes[SDF_BRICK_OFFSETS] = field.m_brickOffsets.size() * sizeof(int32_t);
+    header.sizes[SDF_BRICK_DATA] = field.m_brickData.size() * sizeof(float);
+    header.sizes[STRAND_FIRST_VERTICES] = strands.numStrands() * sizeof(int32_t);
+    header.sizes[STRAND_NUM_VERTICES] = strands.numStrands() * sizeof(int32_t);
+    header.sizes[STRAND_POSITIONS] = strands.numVertices() * sizeof(glm::vec3);
+    header.sizes[STRAND_COLORS] = strands.numStrands() * sizeof(glm::vec3);
+    header.sizes[GROWTH_MAP] = (uint64_t) header.imageBytesPerLine * header.imageHeight;
+
+    // Every section holds 4 byte values, so packing them back to back keeps them aligned.
+    uint64_t offset = sizeof(header);
+    for (int i = 0; i < NUM_SECTIONS; ++i)
+    {
+        header.offsets[i] = offset;
+        offset += header.sizes[i];
+    }
+
+    // Write to a temporary file first so concurrent runs never see half an entry.
+    std::string tempPath = m_path + ".tmp" + std::to_string(QCoreApplication::applicationPid());
+    FILE *f = fopen(tempPath.c_str(), "wb");
+    if (!f)
+    {
+        cerr << "Could not write scene cache " << tempPath << endl;
+        return false;
+    }
+    bool written = fwrite(&header, sizeof(header), 1, f) == 1;
+    for (int i = 0; written && i < NUM_SECTIONS; ++i)
+        written = header.sizes[i] == 0 || fwrite(data[i], header.sizes[i], 1, f) == 1;
+    written = fclose(f) == 0 && written;
+
+    if (!written || rename(tempPath.c_str(), m_path.c_str()) != 0)
+    {
+        cerr << "Could not write scene cache " << m_path << endl;
+        remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
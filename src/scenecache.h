@@ -0,0 +1,54 @@
+#ifndef SCENECACHE_H
+#define SCENECACHE_H
+
+#include "hairCommon.h"
+#include <string>
+
+class QImage;
+class ObjMesh;
+class StrandSet;
+class MappedFile;
+class MeshSDF;
+
+/**
+ * On-disk cache of everything that is slow to rebuild when a scene is loaded:
+ * the transformed head mesh, the distance field of the collision mesh, the
+ * guide hairs with their colors and the blurred growth map. An entry is one binary file, named after a hash of the
+ * input files, the growth map and the random seed, so editing any input or
+ * running with another --seed simply misses the cache. Entries are memory mapped and
+ * copied straight into place on load.
+ *
+ * Entries live in $HAIR_CACHE_DIR, or in the platform cache directory if it
+ * is not set.
+ */
+class SceneCache
+{
+public:
+    SceneCache(const std::string &meshFile, const std::string &hairFile, const QImage &growthMap);
+    virtual ~SceneCache();
+
+    // Maps the entry for this scene. Returns false if there is no usable
+    // entry, including one that is truncated or whose strands index past
+    // their positions.
+    bool open();
+
+    // Fill in the scene from the mapped entry.
+    void restoreMesh(ObjMesh *mesh);
+    // Returns false if the entry was baked for a different collision scale.
+    bool restoreCollisionField(MeshSDF &field, float collisionScale);
+    void restoreHair(StrandSet &strands, QImage &blurredGrowthMap);
+
+    // Writes the entry for this scene. collisionMesh is the scaled copy of
+    // mesh made with collisionScale.
+    bool save(const ObjMesh *mesh, const ObjMesh *collisionMesh, float collisionScale,
+              const StrandSet &strands, const QImage &blurredGrowthMap);
+
+private:
+    const char *_section(int index);
+
+    std::string m_key;
+    std::string m_path;
+    MappedFile *m_file;
+};
+
+#endif // SCENECACHE_H
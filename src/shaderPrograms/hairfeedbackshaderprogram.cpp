@@ -4,11 +4,11 @@
 
 GLuint HairFeedbackShaderProgram::createShaderProgram()
 {
-    const GLchar* varyings[] = {"position_g", "tangent_g", "colorVariation_g", "tessx_g"};
+    const GLchar* varyings[] = {"position_g", "tangent_g", "colorVariation_g", "tessx_g", "color_g", "widthScale_g"};
     return ResourceLoader::createFullFeedbackShaderProgram(
                 ":/shaders/hair.vert",
                 ":/shaders/hairFeedback.geom",
                 ":/shaders/hair.tcs",
                 ":/shaders/hairFeedback.tes",
-                varyings, 4);
+                varyings, 6);
 }
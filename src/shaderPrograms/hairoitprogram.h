@@ -0,0 +1,18 @@
+#ifndef HAIROITPROGRAM_H
+#define HAIROITPROGRAM_H
+
+#include "hairshaderprogram.h"
+#include "resourceloader.h"
+
+class HairOitShaderProgram : public HairShaderProgram
+{
+public:
+    virtual GLuint createShaderProgram() override
+    {
+        return ResourceLoader::createFullShaderProgram(
+                    ":/shaders/hair.vert", ":/shaders/hairOIT.frag", ":/shaders/hair.geom",
+                    ":/shaders/hair.tcs", ":/shaders/hair.tes");
+    }
+};
+
+#endif // HAIROITPROGRAM_H
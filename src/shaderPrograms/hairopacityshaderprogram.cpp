@@ -17,7 +17,14 @@ void HairOpacityShaderProgram::setGlobalUniforms()
     setUniformMatrix4f("eyeToLight", uniforms.eyeToLight);
     setUniform3f("lightPosition", uniforms.lightPosition);
     setUniform1i("shadowMap", uniforms.hairShadowMap);
+    setUniform1f("opacityLayerSize", uniforms.opacityLayerSize);
     setUniform1i("noiseTexture", uniforms.noiseTexture);
+    setUniform1i("strandVertices", uniforms.strandVertices);
+    setUniform1i("strandRanges", uniforms.strandRanges);
+    setUniform1i("strandData", uniforms.strandData);
+    setUniform1i("strandClusters", uniforms.strandClusters);
+    setUniform1i("clusterBounds", uniforms.clusterBounds);
+    setUniform1i("hiZMap", uniforms.hiZMap);
 }
 
 void HairOpacityShaderProgram::setPerObjectUniforms()
@@ -30,14 +37,10 @@ void HairOpacityShaderProgram::setPerObjectUniforms()
     setUniform1f("taperExponent", uniforms.taperExponent);
     setUniform1f("noiseAmplitude", uniforms.noiseAmplitude);
     setUniform1f("noiseFrequency", uniforms.noiseFrequency);
-    setUniform3f("color", uniforms.color);
-}
-
-void HairOpacityShaderProgram::setPerDrawUniforms()
-{
-    setUniform1i("numHairSegments", uniforms.numHairVertices-1);
-    setUniform3fv("vertexData", uniforms.numHairVertices, uniforms.vertexData);
-    setUniform3fv("colorData",uniforms.numHairVertices,uniforms.colorData);
-    setUniform3fv("triangleFace", 2, uniforms.triangleFace);
+    setUniform1i("useCulling", uniforms.useCulling);
+    setUniform1i("useOcclusionCulling", uniforms.useOcclusionCulling);
+    setUniform1f("lodViewportHeight", uniforms.lodViewportHeight);
+    setUniform1f("lodSegmentLength", uniforms.lodSegmentLength);
+    setUniform1f("lodHairDensity", uniforms.lodHairDensity);
     setUniform3f("color", uniforms.color);
 }
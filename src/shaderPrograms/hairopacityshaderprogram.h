@@ -15,14 +15,17 @@ public:
         uniforms.taperExponent = 5.0;
         uniforms.noiseAmplitude = 0;
         uniforms.color = glm::vec3(.6f, .4f, .3f);
+        uniforms.lodViewportHeight = 0;
+        uniforms.lodSegmentLength = 0;
+        uniforms.lodHairDensity = 0;
+        uniforms.useCulling = false;
+        uniforms.useOcclusionCulling = false;
     }
 
     virtual void setGlobalUniforms() override;
 
     virtual void setPerObjectUniforms() override;
 
-    virtual void setPerDrawUniforms() override;
-
 protected:
     virtual GLuint createShaderProgram() override;
 
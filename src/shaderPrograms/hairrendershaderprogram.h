@@ -7,6 +7,7 @@
 #include "resourceloader.h"
 #include "whitehairshaderprogram.h"
 #include "hairdepthpeelprogram.h"
+#include "hairoitprogram.h"
 
 class HairRenderShaderProgram : public HairShaderProgram
 {
@@ -37,6 +38,15 @@ class HairFeedbackDepthPeelShaderProgram : public HairDepthPeelShaderProgram
     }
 };
 
+class HairFeedbackOitShaderProgram : public HairOitShaderProgram
+{
+    virtual GLuint createShaderProgram() override
+    {
+        return ResourceLoader::createBasicShaderProgram(
+                    ":/shaders/hairrender.vert", ":/shaders/hairOIT.frag");
+    }
+};
+
 class WhiteHairFeedbackShaderProgram : public WhiteHairShaderProgram
 {
     virtual GLuint createShaderProgram() override
@@ -20,7 +20,14 @@ void HairShaderProgram::setGlobalUniforms()
     setUniform1i("opacityMap", uniforms.opacityMap);
     setUniform1i("depthPeelMap", uniforms.depthPeelMap);
     setUniform1i("noiseTexture", uniforms.noiseTexture);
+    setUniform1i("strandVertices", uniforms.strandVertices);
+    setUniform1i("strandRanges", uniforms.strandRanges);
+    setUniform1i("strandData", uniforms.strandData);
+    setUniform1i("strandClusters", uniforms.strandClusters);
+    setUniform1i("clusterBounds", uniforms.clusterBounds);
+    setUniform1i("hiZMap", uniforms.hiZMap);
     setUniform1f("shadowIntensity", uniforms.shadowIntensity);
+    setUniform1f("opacityLayerSize", uniforms.opacityLayerSize);
     setUniform1i("useShadows", uniforms.useShadows);
 }
 
@@ -34,18 +41,14 @@ void HairShaderProgram::setPerObjectUniforms()
     setUniform1f("taperExponent", uniforms.taperExponent);
     setUniform1f("noiseAmplitude", uniforms.noiseAmplitude);
     setUniform1f("noiseFrequency", uniforms.noiseFrequency);
+    setUniform1i("useCulling", uniforms.useCulling);
+    setUniform1i("useOcclusionCulling", uniforms.useOcclusionCulling);
+    setUniform1f("lodViewportHeight", uniforms.lodViewportHeight);
+    setUniform1f("lodSegmentLength", uniforms.lodSegmentLength);
+    setUniform1f("lodHairDensity", uniforms.lodHairDensity);
     setUniform3f("color", uniforms.color);
     setUniform1f("specIntensity", uniforms.specIntensity);
     setUniform1f("diffuseIntensity", uniforms.diffuseIntensity);
     setUniform1f("opacity", uniforms.opacity);
     setUniform1f("maxColorVariation", uniforms.maxColorVariation);
 }
-
-void HairShaderProgram::setPerDrawUniforms()
-{
-    setUniform1f("hairLength", uniforms.length);
-    setUniform1i("numHairSegments", uniforms.numHairVertices-1);
-    setUniform3fv("vertexData", uniforms.numHairVertices, uniforms.vertexData);
-    setUniform3fv("colorData", uniforms.numHairVertices, uniforms.colorData);
-    setUniform3fv("triangleFace", 2, uniforms.triangleFace);
-}
@@ -0,0 +1,24 @@
+#ifndef HIZDOWNSAMPLESHADERPROGRAM_H
+#define HIZDOWNSAMPLESHADERPROGRAM_H
+
+#include "shaderprogram.h"
+#include "resourceloader.h"
+
+// Builds a level of a Hi-Z pyramid from the level below (see HiZBuffer).
+class HiZDownsampleShaderProgram : public ShaderProgram
+{
+public:
+    virtual void setGlobalUniforms() override
+    {
+        setUniform1i("hiZMap", uniforms.hiZMap);
+    }
+
+protected:
+    virtual GLuint createShaderProgram() override
+    {
+        return ResourceLoader::createBasicShaderProgram(
+                    ":/shaders/texturedquad.vert", ":/shaders/hizdownsample.frag");
+    }
+};
+
+#endif // HIZDOWNSAMPLESHADERPROGRAM_H
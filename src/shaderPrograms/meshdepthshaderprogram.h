@@ -0,0 +1,17 @@
+#ifndef MESHDEPTHSHADERPROGRAM_H
+#define MESHDEPTHSHADERPROGRAM_H
+
+#include "meshshaderprogram.h"
+#include "resourceloader.h"
+
+// Writes the window depth of the mesh as its color, for the Hi-Z pyramid.
+class MeshDepthShaderProgram : public MeshShaderProgram
+{
+protected:
+    GLuint createShaderProgram() override
+    {
+        return ResourceLoader::createBasicShaderProgram(":/shaders/mesh.vert", ":/shaders/meshdepth.frag");
+    }
+};
+
+#endif // MESHDEPTHSHADERPROGRAM_H
@@ -18,6 +18,7 @@ void MeshShaderProgram::setGlobalUniforms()
     setUniform1i("opacityMap", uniforms.opacityMap);
     setUniform3f("lightPosition", uniforms.lightPosition);
     setUniform1f("shadowIntensity", uniforms.shadowIntensity);
+    setUniform1f("opacityLayerSize", uniforms.opacityLayerSize);
     setUniform1i("useShadows", uniforms.useShadows);
 }
 
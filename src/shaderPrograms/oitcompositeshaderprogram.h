@@ -0,0 +1,25 @@
+#ifndef OITCOMPOSITESHADERPROGRAM_H
+#define OITCOMPOSITESHADERPROGRAM_H
+
+#include "shaderprogram.h"
+#include "resourceloader.h"
+
+// Resolves the targets of weighted blended transparency over the opaque scene.
+class OitCompositeShaderProgram : public ShaderProgram
+{
+public:
+    virtual void setGlobalUniforms() override
+    {
+        setUniform1i("accumulationMap", uniforms.accumulationMap);
+        setUniform1i("revealageMap", uniforms.revealageMap);
+    }
+
+protected:
+    virtual GLuint createShaderProgram() override
+    {
+        return ResourceLoader::createBasicShaderProgram(
+                    ":/shaders/texturedquad.vert", ":/shaders/oitcomposite.frag");
+    }
+};
+
+#endif // OITCOMPOSITESHADERPROGRAM_H
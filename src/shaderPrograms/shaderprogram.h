@@ -5,8 +5,6 @@
 #include <map>
 #include <string>
 
-#define MAX_HAIR_VERTICES 300
-
 struct Uniforms {
     glm::mat4 model, view, projection;
 
@@ -14,12 +12,6 @@ struct Uniforms {
 
     glm::mat4 eyeToLight; // Matrix for rendering shadow map (eye space --> light space).
 
-    int numHairVertices; // Number of vertices per guide hair.
-
-    glm::vec3 vertexData[MAX_HAIR_VERTICES]; // Vertex position data for the current guide hair.
-
-    glm::vec3 colorData[MAX_HAIR_VERTICES]; // vertex color data for the current guide hair.
-
     int numGroupHairs; // Number of single-hair-interpolated hairs per guide hair.
 
     int numSplineVertices; // Number of vertices rendered with a spline.
@@ -33,11 +25,16 @@ struct Uniforms {
     float noiseAmplitude; // Amount of noise added to each hair vertex poistion.
     float noiseFrequency;
 
-    glm::vec3 triangleFace[2]; // Basis vectors for the plane orthogonal to the hair's normal vector.
+    // Level of detail (see hair.tcs); full detail while lodSegmentLength is 0.
+    float lodViewportHeight; // Pixels
+    float lodSegmentLength; // Pixels each spline segment should cover
+    float lodHairDensity; // Interpolated hairs per pixel across a hair group
 
-    glm::vec3 color;
+    // Culling of strand clusters (see hair.tcs).
+    bool useCulling; // Against the view frustum
+    bool useOcclusionCulling; // Against hiZMap as well
 
-    float length;
+    glm::vec3 color;
 
     // Texture uniforms
     int noiseTexture;
@@ -46,6 +43,14 @@ struct Uniforms {
     int opacityMap;
     int hairGrowthMap;
     int depthPeelMap;
+    int strandVertices; // Buffer textures with the guide hairs of all strands (see StrandBuffer).
+    int strandRanges;
+    int strandData;
+    int accumulationMap; // Targets of weighted blended transparency.
+    int revealageMap;
+    int strandClusters; // Buffer textures with the cluster of each strand and the cluster bounds.
+    int clusterBounds;
+    int hiZMap; // Farthest occluder depth pyramid (see HiZBuffer).
 
     float specIntensity;
     float diffuseIntensity;
@@ -56,6 +61,7 @@ struct Uniforms {
     // Shadows
     bool useShadows;
     float shadowIntensity; // Controls the shadow darkness
+    float opacityLayerSize; // Light depth of the first deep opacity map layer
 };
 
 class ShaderProgram
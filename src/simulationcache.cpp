@@ -0,0 +1,196 @@
+#include "simulationcache.h"
+
+#include "mappedfile.h"
+
+#include <float.h>
+
+/*
+ * @file simulationcache.cpp
+ *
+ * Baked simulation frames
+ */
+
+// Bump whenever the layout below changes.
+#define SIMULATION_CACHE_VERSION 1
+
+#define QUANTIZATION_STEPS 65535.f
+
+struct SimulationCacheHeader
+{
+    char magic[8];
+    uint32_t version;
+    int32_t numVertices;
+    int32_t numFrames;
+    float frameTime;
+    uint64_t indexOffset; // numFrames chunk offsets, relative to the start of the file
+};
+
+// Precedes the quantized positions of every frame.
+struct SimulationCacheFrame
+{
+    glm::vec3 origin;
+    glm::vec3 scale; // Size of one quantization step
+};
+
+static const char SIMULATION_CACHE_MAGIC[8] = {'H', 'A', 'I', 'R', 'S', 'I', 'M', '\0'};
+
+SimulationCache::SimulationCache()
+{
+    m_numFrames = 0;
+    m_numVertices = 0;
+    m_frameTime = 0;
+    m_writeFile = NULL;
+    m_file = NULL;
+    m_index = NULL;
+}
+
+SimulationCache::~SimulationCache()
+{
+    finish();
+    safeDelete(m_file);
+}
+
+bool SimulationCache::create(const std::string &filename, int numVertices, float frameTime)
+{
+    finish();
+    safeDelete(m_file);
+    m_index = NULL;
+
+    m_writeFile = fopen(filename.c_str(), "wb");
+    if (m_writeFile == NULL)
+    {
+        cerr << "Could not create simulation cache " << filename << endl;
+        return false;
+    }
+
+    m_numFrames = 0;
+    m_numVertices = numVertices;
+    m_frameTime = frameTime;
+    m_offsets.clear();
+    m_quantized.resize(3 * numVertices);
+
+    // The header is written again with the frame count and index by finish().
+    SimulationCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    return fwrite(&header, sizeof(header), 1, m_writeFile) == 1;
+}
+
+bool SimulationCache::append(const std::vector<glm::vec3> &positions)
+{
+    if (m_writeFile == NULL || (int) positions.size() != m_numVertices)
+        return false;
+
+    SimulationCacheFrame frame;
+    glm::vec3 minPos = glm::vec3(FLT_MAX);
+    glm::vec3 maxPos = glm::vec3(-FLT_MAX);
+    for (int i = 0; i < m_numVertices; ++i)
+    {
+        minPos = glm::min(minPos, positions[i]);
+        maxPos = glm::max(maxPos, positions[i]);
+    }
+    if (m_numVertices == 0)
+        minPos = maxPos = glm::vec3(0.0);
+    frame.origin = minPos;
+    frame.scale = (maxPos - minPos) / QUANTIZATION_STEPS;
+
+    glm::vec3 invScale = 1.f / glm::max(frame.scale, glm::vec3(FLT_MIN));
+    for (int i = 0; i < m_numVertices; ++i)
+    {
+        glm::vec3 q = glm::clamp((positions[i] - frame.origin) * invScale + 0.5f, glm::vec3(0.0), glm::vec3(QUANTIZATION_STEPS));
+        m_quantized[3 * i] = (uint16_t) q.x;
+        m_quantized[3 * i + 1] = (uint16_t) q.y;
+        m_quantized[3 * i + 2] = (uint16_t) q.z;
+    }
+
+    m_offsets.push_back(ftell(m_writeFile));
+    bool ok = fwrite(&frame, sizeof(frame), 1, m_writeFile) == 1 &&
+            fwrite(m_quantized.data(), sizeof(uint16_t), m_quantized.size(), m_writeFile) == m_quantized.size();
+    if (ok)
+        m_numFrames++;
+    return ok;
+}
+
+bool SimulationCache::finish()
+{
+    if (m_writeFile == NULL)
+        return true;
+
+    // Keeps the index aligned for reading it in place.
+    long end = ftell(m_writeFile);
+    long padding = (sizeof(uint64_t) - end % sizeof(uint64_t)) % sizeof(uint64_t);
+    uint64_t zero = 0;
+    fwrite(&zero, 1, padding, m_writeFile);
+
+    SimulationCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SIMULATION_CACHE_MAGIC, sizeof(SIMULATION_CACHE_MAGIC));
+    header.version = SIMULATION_CACHE_VERSION;
+    header.numVertices = m_numVertices;
+    header.numFrames = m_numFrames;
+    header.frameTime = m_frameTime;
+    header.indexOffset = end + padding;
+
+    bool ok = fwrite(m_offsets.data(), sizeof(uint64_t), m_offsets.size(), m_writeFile) == m_offsets.size();
+    ok = ok && fseek(m_writeFile, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, m_writeFile) == 1;
+    ok = fclose(m_writeFile) == 0 && ok;
+    m_writeFile = NULL;
+
+    if (!ok)
+        cerr << "Could not write the simulation cache" << endl;
+    return ok;
+}
+
+bool SimulationCache::open(const std::string &filename)
+{
+    finish();
+    safeDelete(m_file);
+    m_index = NULL;
+    m_numFrames = 0;
+
+    m_file = new MappedFile(filename.c_str());
+    const SimulationCacheHeader *header = (const SimulationCacheHeader *) m_file->data();
+    bool valid = m_file->valid() && m_file->size() >= sizeof(SimulationCacheHeader) &&
+            memcmp(header->magic, SIMULATION_CACHE_MAGIC, sizeof(SIMULATION_CACHE_MAGIC)) == 0 &&
+            header->version == SIMULATION_CACHE_VERSION &&
+            header->numVertices >= 0 && header->numFrames >= 0 &&
+            header->indexOffset % sizeof(uint64_t) == 0 &&
+            header->indexOffset + header->numFrames * sizeof(uint64_t) <= m_file->size();
+
+    uint64_t frameSize = sizeof(SimulationCacheFrame) + 3 * sizeof(uint16_t) * (uint64_t) (valid ? header->numVertices : 0);
+    const uint64_t *index = valid ? (const uint64_t *) (m_file->data() + header->indexOffset) : NULL;
+    for (int i = 0; valid && i < header->numFrames; ++i)
+        valid = index[i] % sizeof(float) == 0 && index[i] + frameSize <= header->indexOffset;
+
+    if (!valid)
+    {
+        cerr << "Could not read simulation cache " << filename << endl;
+        safeDelete(m_file);
+        return false;
+    }
+
+    m_numFrames = header->numFrames;
+    m_numVertices = header->numVertices;
+    m_frameTime = header->frameTime;
+    m_index = index;
+    cout << "Playing " << m_numFrames << " frames from simulation cache " << filename << endl;
+    return true;
+}
+
+bool SimulationCache::frame(int index, std::vector<glm::vec3> &positions) const
+{
+    if (m_file == NULL || index < 0 || index >= m_numFrames)
+        return false;
+
+    const char *chunk = m_file->data() + m_index[index];
+    SimulationCacheFrame frame;
+    memcpy((void *) &frame, chunk, sizeof(frame));
+    const uint16_t *quantized = (const uint16_t *) (chunk + sizeof(frame));
+
+    positions.resize(m_numVertices);
+    for (int i = 0; i < m_numVertices; ++i)
+    {
+        glm::vec3 q = glm::vec3(quantized[3 * i], quantized[3 * i + 1], quantized[3 * i + 2]);
+        positions[i] = frame.origin + q * frame.scale;
+    }
+    return true;
+}
@@ -0,0 +1,56 @@
+#ifndef SIMULATIONCACHE_H
+#define SIMULATIONCACHE_H
+
+#include "hairCommon.h"
+#include <stdint.h>
+#include <string>
+
+class MappedFile;
+
+/**
+ * Guide hair positions of a simulation run, baked to disk once and played back
+ * any number of times, e.g. for renders from several angles or with different
+ * lighting, without running the solver. The file is a header, one chunk per
+ * frame and an index of the chunk offsets at the end. Each chunk holds the
+ * bounds of its frame and every position quantized to 16 bits per coordinate
+ * within them, half the size of the floats.
+ *
+ * A cache is either written (create, append, finish) or read (open, frame).
+ * Reading maps the file, so any frame can be fetched directly, from any thread.
+ */
+class SimulationCache
+{
+public:
+    SimulationCache();
+    virtual ~SimulationCache();
+
+    // Starts a new cache for numVertices positions per frame, frameTime
+    // simulated seconds apart.
+    bool create(const std::string &filename, int numVertices, float frameTime);
+    bool append(const std::vector<glm::vec3> &positions);
+    // Writes the index. Called by the destructor if need be.
+    bool finish();
+
+    bool open(const std::string &filename);
+    bool frame(int index, std::vector<glm::vec3> &positions) const;
+
+    int numFrames() const { return m_numFrames; }
+    int numVertices() const { return m_numVertices; }
+    float frameTime() const { return m_frameTime; }
+
+private:
+    int m_numFrames;
+    int m_numVertices;
+    float m_frameTime;
+
+    // Writing
+    FILE *m_writeFile;
+    std::vector<uint64_t> m_offsets;
+    std::vector<uint16_t> m_quantized;
+
+    // Reading
+    MappedFile *m_file;
+    const uint64_t *m_index;
+};
+
+#endif // SIMULATIONCACHE_H
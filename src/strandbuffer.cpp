@@ -0,0 +1,233 @@
+#include "strandbuffer.h"
+
+#include "strandset.h"
+#include "errorchecker.h"
+
+#include <algorithm>
+
+// Strands culled together. Small enough for tight boxes, large enough that
+// updating and testing the boxes costs little next to drawing the strands.
+#define STRANDS_PER_CLUSTER 64
+
+// Bits per axis of the Morton codes the strands are ordered by.
+#define MORTON_BITS 10
+
+StrandBuffer::StrandBuffer()
+{
+    m_numStrands = 0;
+    m_numVertices = 0;
+    m_vaoID = 0;
+    m_verticesBufferID = m_verticesTextureID = 0;
+    m_rangesBufferID = m_rangesTextureID = 0;
+    m_dataBufferID = m_dataTextureID = 0;
+    m_clustersBufferID = m_clustersTextureID = 0;
+    m_boundsBufferID = m_boundsTextureID = 0;
+    m_boundsMin = m_boundsMax = glm::vec3(0);
+}
+
+StrandBuffer::~StrandBuffer()
+{
+    GLuint textures[] = {m_verticesTextureID, m_rangesTextureID, m_dataTextureID,
+                         m_clustersTextureID, m_boundsTextureID};
+    GLuint buffers[] = {m_verticesBufferID, m_rangesBufferID, m_dataBufferID,
+                        m_clustersBufferID, m_boundsBufferID};
+    glDeleteTextures(5, textures);
+    glDeleteBuffers(5, buffers);
+    glDeleteVertexArrays(1, &m_vaoID);
+}
+
+void StrandBuffer::create(const StrandSet &strands)
+{
+    m_numStrands = strands.numStrands();
+    m_numVertices = strands.numVertices();
+
+    std::vector<GLint> &ranges = m_ranges;
+    std::vector<glm::vec4> data;
+    ranges.clear();
+    ranges.reserve(2 * m_numStrands);
+    data.reserve(3 * m_numStrands);
+    for (int i = 0; i < m_numStrands; i++)
+    {
+        ranges.push_back(strands.firstVertex(i));
+        ranges.push_back(strands.numVertices(i));
+        data.push_back(glm::vec4(strands.m_triangleFaces[2 * i], strands.m_lengths[i]));
+        data.push_back(glm::vec4(strands.m_triangleFaces[2 * i + 1], 0.f));
+        data.push_back(glm::vec4(strands.m_colors[i], 1.f));
+    }
+
+    GLint maxTexels;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+    if (m_numVertices > maxTexels)
+        cerr << "Hair has " << m_numVertices << " vertices, but buffer textures are limited to " << maxTexels << endl;
+
+    _createBufferTexture(m_verticesBufferID, m_verticesTextureID, GL_RGB32F,
+                         NULL, m_numVertices * sizeof(glm::vec3), GL_DYNAMIC_DRAW);
+    _createBufferTexture(m_rangesBufferID, m_rangesTextureID, GL_RG32I,
+                         ranges.data(), ranges.size() * sizeof(GLint), GL_STATIC_DRAW);
+    _createBufferTexture(m_dataBufferID, m_dataTextureID, GL_RGBA32F,
+                         data.data(), data.size() * sizeof(glm::vec4), GL_STATIC_DRAW);
+
+    _buildClusters(strands);
+    _createBufferTexture(m_clustersBufferID, m_clustersTextureID, GL_R32I,
+                         m_strandClusters.data(), m_strandClusters.size() * sizeof(GLint), GL_STATIC_DRAW);
+    _createBufferTexture(m_boundsBufferID, m_boundsTextureID, GL_RGBA32F,
+                         NULL, m_clusterBounds.size() * sizeof(glm::vec4), GL_DYNAMIC_DRAW);
+    update(strands.m_positions);
+
+    // The patches have no attributes, but core profile still needs a bound VAO.
+    glGenVertexArrays(1, &m_vaoID);
+
+    ErrorChecker::printGLErrors("end of StrandBuffer::create");
+}
+
+void StrandBuffer::_buildClusters(const StrandSet &strands)
+{
+    glm::vec3 boxMin = glm::vec3(FLT_MAX), boxMax = glm::vec3(-FLT_MAX);
+    for (int i = 0; i < m_numStrands; i++)
+    {
+        glm::vec3 root = strands.m_positions[strands.firstVertex(i)];
+        boxMin = glm::min(boxMin, root);
+        boxMax = glm::max(boxMax, root);
+    }
+    glm::vec3 scale = float((1 << MORTON_BITS) - 1) / glm::max(boxMax - boxMin, glm::vec3(1e-6f));
+
+    // Interleave the bits of the quantized root coordinates.
+    std::vector<std::pair<uint64_t, int> > order(m_numStrands);
+    for (int i = 0; i < m_numStrands; i++)
+    {
+        glm::vec3 cell = (strands.m_positions[strands.firstVertex(i)] - boxMin) * scale;
+        uint64_t code = 0;
+        for (int bit = MORTON_BITS - 1; bit >= 0; bit--)
+            for (int axis = 0; axis < 3; axis++)
+                code = (code << 1) | (((uint32_t) cell[axis] >> bit) & 1);
+        order[i] = std::make_pair(code, i);
+    }
+    std::sort(order.begin(), order.end());
+
+    m_strandClusters.resize(m_numStrands);
+    for (int i = 0; i < m_numStrands; i++)
+        m_strandClusters[order[i].second] = i / STRANDS_PER_CLUSTER;
+    m_clusterBounds.resize(2 * ((m_numStrands + STRANDS_PER_CLUSTER - 1) / STRANDS_PER_CLUSTER));
+}
+
+void StrandBuffer::_createBufferTexture(GLuint &bufferID, GLuint &textureID, GLenum internalFormat,
+                                        const void *data, int size, GLenum usage)
+{
+    glGenBuffers(1, &bufferID);
+    glBindBuffer(GL_TEXTURE_BUFFER, bufferID);
+    glBufferData(GL_TEXTURE_BUFFER, size, data, usage);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_BUFFER, textureID);
+    glTexBuffer(GL_TEXTURE_BUFFER, internalFormat, bufferID);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+void StrandBuffer::update(const std::vector<glm::vec3> &positions)
+{
+    // One upload per frame for all strands, shared by every pass.
+    glBindBuffer(GL_TEXTURE_BUFFER, m_verticesBufferID);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, m_numVertices * sizeof(glm::vec3), positions.data());
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    // Bound the clusters where the strands are now.
+    for (unsigned int i = 0; i < m_clusterBounds.size(); i += 2)
+    {
+        m_clusterBounds[i] = glm::vec4(FLT_MAX);
+        m_clusterBounds[i + 1] = glm::vec4(-FLT_MAX);
+    }
+    for (int i = 0; i < m_numStrands; i++)
+    {
+        glm::vec4 *bounds = &m_clusterBounds[2 * m_strandClusters[i]];
+        const glm::vec3 *vertex = &positions[m_ranges[2 * i]];
+        glm::vec3 boxMin = glm::vec3(bounds[0]), boxMax = glm::vec3(bounds[1]);
+        for (int j = 0; j < m_ranges[2 * i + 1]; j++)
+        {
+            boxMin = glm::min(boxMin, vertex[j]);
+            boxMax = glm::max(boxMax, vertex[j]);
+        }
+        bounds[0] = glm::vec4(boxMin, 1.f);
+        bounds[1] = glm::vec4(boxMax, 1.f);
+    }
+    m_boundsMin = glm::vec3(FLT_MAX);
+    m_boundsMax = glm::vec3(-FLT_MAX);
+    for (unsigned int i = 0; i < m_clusterBounds.size(); i += 2)
+    {
+        m_boundsMin = glm::min(m_boundsMin, glm::vec3(m_clusterBounds[i]));
+        m_boundsMax = glm::max(m_boundsMax, glm::vec3(m_clusterBounds[i + 1]));
+    }
+
+    glBindBuffer(GL_TEXTURE_BUFFER, m_boundsBufferID);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, m_clusterBounds.size() * sizeof(glm::vec4), m_clusterBounds.data());
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void StrandBuffer::bind(GLenum verticesUnit, GLenum rangesUnit, GLenum dataUnit)
+{
+    glActiveTexture(verticesUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, m_verticesTextureID);
+    glActiveTexture(rangesUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, m_rangesTextureID);
+    glActiveTexture(dataUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, m_dataTextureID);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void StrandBuffer::unbind(GLenum verticesUnit, GLenum rangesUnit, GLenum dataUnit)
+{
+    glActiveTexture(verticesUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glActiveTexture(rangesUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glActiveTexture(dataUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void StrandBuffer::bindClusters(GLenum clustersUnit, GLenum boundsUnit)
+{
+    glActiveTexture(clustersUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, m_clustersTextureID);
+    glActiveTexture(boundsUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, m_boundsTextureID);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void StrandBuffer::unbindClusters(GLenum clustersUnit, GLenum boundsUnit)
+{
+    glActiveTexture(clustersUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glActiveTexture(boundsUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void StrandBuffer::draw()
+{
+    glBindVertexArray(m_vaoID);
+    glPatchParameteri(GL_PATCH_VERTICES, 1);
+    glDrawArrays(GL_PATCHES, 0, m_numStrands);
+    glBindVertexArray(0);
+}
+
+int StrandBuffer::numStrands()
+{
+    return m_numStrands;
+}
+
+int StrandBuffer::numVertices()
+{
+    return m_numVertices;
+}
+
+int StrandBuffer::numClusters()
+{
+    return m_clusterBounds.size() / 2;
+}
+
+void StrandBuffer::bounds(glm::vec3 &boxMin, glm::vec3 &boxMax)
+{
+    boxMin = m_boundsMin;
+    boxMax = m_boundsMax;
+}
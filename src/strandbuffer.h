@@ -0,0 +1,74 @@
+#ifndef STRANDBUFFER_H
+#define STRANDBUFFER_H
+
+#include "hairCommon.h"
+
+class StrandSet;
+
+/**
+ * All guide hairs of a HairObject packed into buffer textures, so every pass
+ * draws the whole hair style with one call instead of one call per guide hair.
+ * The tessellation shaders (see strands.glsl) find their strand by gl_PrimitiveID.
+ *
+ * Strands are also grouped into clusters of nearby roots, whose bounding boxes
+ * follow the simulated positions. hair.tcs culls whole clusters that are
+ * outside the view or hidden behind the head, by discarding the patches of
+ * their strands. A pre-pass that tests each cluster once and draws only the
+ * visible ones with glDrawArraysIndirect would save the vertex and control
+ * shader run per culled strand. Testing in hair.tcs is deliberate: it keeps
+ * one plain draw in strand order, shared by the transform feedback and direct
+ * paths. The tessellation skipped dominates the cost either way.
+ */
+class StrandBuffer
+{
+public:
+    StrandBuffer();
+    virtual ~StrandBuffer();
+
+    // Packs the vertex positions and per-strand data (basis vectors, length, color).
+    void create(const StrandSet &strands);
+
+    // Re-uploads the vertex positions after the simulation moved them, and
+    // the cluster bounds around them.
+    void update(const std::vector<glm::vec3> &positions);
+
+    void bind(GLenum verticesUnit, GLenum rangesUnit, GLenum dataUnit);
+    void unbind(GLenum verticesUnit, GLenum rangesUnit, GLenum dataUnit);
+
+    void bindClusters(GLenum clustersUnit, GLenum boundsUnit);
+    void unbindClusters(GLenum clustersUnit, GLenum boundsUnit);
+
+    // Draws one patch per strand.
+    void draw();
+
+    int numStrands();
+    int numVertices();
+    int numClusters();
+
+    // Bounding box of all strands as of the last update.
+    void bounds(glm::vec3 &boxMin, glm::vec3 &boxMax);
+
+private:
+    // Groups strands whose roots are close: consecutive strands in the Morton
+    // order of their roots, STRANDS_PER_CLUSTER at a time.
+    void _buildClusters(const StrandSet &strands);
+
+    void _createBufferTexture(GLuint &bufferID, GLuint &textureID, GLenum internalFormat,
+                              const void *data, int size, GLenum usage);
+
+    int m_numStrands, m_numVertices;
+
+    std::vector<GLint> m_ranges;
+    std::vector<GLint> m_strandClusters; // Cluster of each strand
+    std::vector<glm::vec4> m_clusterBounds; // Min and max corner of each cluster
+    glm::vec3 m_boundsMin, m_boundsMax;
+
+    GLuint m_vaoID;
+    GLuint m_verticesBufferID, m_verticesTextureID; // RGB32F, one texel per vertex
+    GLuint m_rangesBufferID, m_rangesTextureID;     // RG32I, (first vertex, vertex count) per strand
+    GLuint m_dataBufferID, m_dataTextureID;         // RGBA32F, three texels per strand
+    GLuint m_clustersBufferID, m_clustersTextureID; // R32I, cluster per strand
+    GLuint m_boundsBufferID, m_boundsTextureID;     // RGBA32F, min and max corner per cluster
+};
+
+#endif // STRANDBUFFER_H
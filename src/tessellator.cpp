@@ -4,6 +4,25 @@
 #include "resourceloader.h"
 #include "errorchecker.h"
 
+// Floats per vertex: position.xyz, tangent.xyz, colorVariation, tessx, color.rgb, widthScale
+#define FLOATS_PER_VERTEX 12
+
+// Room added on top of the triangles generated when the buffer has to grow,
+// so a slowly growing count does not reallocate every time.
+#define GROWTH_FACTOR 1.25f
+
+// Largest buffer, in bytes, allocated up front for the most triangles a
+// tessellation can generate, so that its count never has to be waited for.
+#define MAX_RESERVED_BYTES (256 << 20)
+
+static GLsizeiptr bufferSize(int numTriangles)
+{
+    return (GLsizeiptr) numTriangles
+            * 3 // vertices per triangle
+            * FLOATS_PER_VERTEX
+            * sizeof(GLfloat);
+}
+
 Tessellator::Tessellator()
 {
     program = new HairFeedbackShaderProgram();
@@ -14,6 +33,7 @@ Tessellator::~Tessellator()
     glDeleteVertexArrays(1, &m_vaoID);
     glDeleteBuffers(1, &m_bufferID);
     glDeleteQueries(1, &m_primitivesQuery);
+    glDeleteTransformFeedbacks(1, &m_feedbackID);
     safeDelete(program);
 }
 
@@ -25,66 +45,122 @@ void Tessellator::init(int numTriangles)
     glGenVertexArrays(1, &m_vaoID);
     glGenBuffers(1, &m_bufferID);
     glGenQueries(1, &m_primitivesQuery);
+    glGenTransformFeedbacks(1, &m_feedbackID);
 
-    setNumTriangles(numTriangles);
+    reserve(numTriangles);
+    m_numTriangles = numTriangles;
 
-    // Enable position and tangent attributes.
+    // Enable position, tangent, color variation, tessx, color and width attributes.
+    GLsizei stride = FLOATS_PER_VERTEX * sizeof(GLfloat);
     glBindVertexArray(m_vaoID);
     glBindBuffer(GL_ARRAY_BUFFER, m_bufferID);
     glEnableVertexAttribArray(0);
     glEnableVertexAttribArray(1);
     glEnableVertexAttribArray(2);
     glEnableVertexAttribArray(3);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), 0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
-    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (GLvoid*)(6 * sizeof(GLfloat)));
-    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (GLvoid*)(7 * sizeof(GLfloat)));
+    glEnableVertexAttribArray(4);
+    glEnableVertexAttribArray(5);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, 0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (GLvoid*)(3 * sizeof(GLfloat)));
+    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, stride, (GLvoid*)(6 * sizeof(GLfloat)));
+    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, stride, (GLvoid*)(7 * sizeof(GLfloat)));
+    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, stride, (GLvoid*)(8 * sizeof(GLfloat)));
+    glVertexAttribPointer(5, 1, GL_FLOAT, GL_FALSE, stride, (GLvoid*)(11 * sizeof(GLfloat)));
     glBindVertexArray(0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
-bool Tessellator::setNumTriangles(int numTriangles)
+bool Tessellator::reserve(int numTriangles)
 {
-    if (numTriangles != m_numTriangles)
+    if (numTriangles > m_capacity)
     {
-        m_numTriangles = numTriangles;
-        int bufferSize = numTriangles
-                * 3 // vertices per triangle
-                * 8 // floats per vertex (position.xyz, tangent.xyz, colorVariation, offset
-                * sizeof(GLfloat);
+        m_capacity = numTriangles;
 
         // Re-initialize transform feedback buffer.
         glBindBuffer(GL_ARRAY_BUFFER, m_bufferID);
-        glBufferData(GL_ARRAY_BUFFER, bufferSize, NULL, GL_DYNAMIC_COPY);
+        glBufferData(GL_ARRAY_BUFFER, bufferSize(numTriangles), NULL, GL_DYNAMIC_COPY);
         glBindBuffer(GL_ARRAY_BUFFER, 0);
         return true;
     }
     return false;
 }
 
+bool Tessellator::_readCount(bool wait)
+{
+    GLuint available = wait;
+    if (!wait)
+        glGetQueryObjectuiv(m_primitivesQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available)
+        return false;
+
+    GLuint generated = 0;
+    glGetQueryObjectuiv(m_primitivesQuery, GL_QUERY_RESULT, &generated);
+    m_queryPending = false;
+    m_numTriangles = generated;
+    if ((int) generated > m_capacity)
+    {
+        reserve(generated * GROWTH_FACTOR);
+        return true;
+    }
+    return false;
+}
+
+void Tessellator::setMaxTriangles(int numTriangles)
+{
+    m_maxTriangles = numTriangles;
+    if (bufferSize(numTriangles) <= MAX_RESERVED_BYTES)
+        reserve(numTriangles);
+}
+
+bool Tessellator::_mayOverflow() const
+{
+    return m_capacity < m_maxTriangles;
+}
+
 void Tessellator::beginTessellation()
 {
+    // Read the count of an earlier tessellation once the GPU has it, rather
+    // than waiting for it, unless this one may not fit and has to be counted
+    // too.
+    if (m_queryPending)
+        _readCount(_mayOverflow());
+
     program->bind();
     glEnable(GL_RASTERIZER_DISCARD);
+    glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, m_feedbackID);
     glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, m_bufferID);
 
-    // Keep track of the number of primitives written.
-//    glBeginQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, m_primitivesQuery); //TODO?
+    // Keep track of the number of primitives generated, written or not.
+    m_counting = !m_queryPending;
+    if (m_counting)
+        glBeginQuery(GL_PRIMITIVES_GENERATED, m_primitivesQuery);
 
     glBeginTransformFeedback(GL_TRIANGLES);
 }
 
-void Tessellator::endTessellation()
+bool Tessellator::endTessellation()
 {
     glEndTransformFeedback();
+    if (m_counting)
+    {
+        glEndQuery(GL_PRIMITIVES_GENERATED);
+        m_queryPending = true;
+    }
+    glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
     glDisable(GL_RASTERIZER_DISCARD);
     program->unbind();
-    glFlush();
+
+    // Unless the buffer holds the most triangles there can be, wait for the
+    // count to know whether every triangle made it in.
+    if (m_counting && _mayOverflow())
+        return _readCount(true);
+    return false;
 }
 
 void Tessellator::draw()
 {
+    // Draws as many vertices as the last tessellation wrote into the buffer.
     glBindVertexArray(m_vaoID);
-    glDrawArrays(GL_TRIANGLES, 0, m_numTriangles * 3);
+    glDrawTransformFeedback(GL_TRIANGLES, m_feedbackID);
     glBindVertexArray(0);
 }
@@ -3,8 +3,22 @@
 
 #include "hairCommon.h"
 
+#include <climits>
+
 class ShaderProgram;
 
+/**
+ * Tessellates the hair once per frame into a transform feedback buffer, so
+ * the shadow, opacity and color passes all draw the same triangles with the
+ * cheap hairrender.vert billboard shader instead of each evaluating the
+ * splines and noise again. Draws take the number of triangles straight from
+ * the feedback object; a query keeps track of how many the tessellation
+ * generates and the buffer grows when they no longer fit. When the buffer
+ * holds the most triangles a tessellation can generate (see setMaxTriangles)
+ * the count is read back without waiting. Otherwise endTessellation waits for
+ * it, so a tessellation that did not fit is redone in the same frame instead
+ * of drawn with triangles missing.
+ */
 class Tessellator
 {
 public:
@@ -14,19 +28,42 @@ public:
 
     void init(int numTriangles);
 
-    bool setNumTriangles(int numTriangles);
+    // Makes room for at least numTriangles triangles. Returns whether the
+    // buffer was reallocated.
+    bool reserve(int numTriangles);
+
+    // The most triangles a tessellation can generate, whatever the level of
+    // detail and culling. Reserved right away if the buffer stays small enough;
+    // otherwise every tessellation waits for its count.
+    void setMaxTriangles(int numTriangles);
 
     void beginTessellation();
 
-    void endTessellation();
+    // Returns true when the tessellation outgrew the buffer. The buffer has
+    // grown by then; tessellate again before drawing.
+    bool endTessellation();
 
     void draw();
 
+    // Triangles generated by the latest tessellation whose count has come back.
+    int numTriangles() const { return m_numTriangles; }
+
     ShaderProgram *program;
 
 private:
+    // Takes the count of the pending query, waiting for it if wait. Returns
+    // whether the count outgrew the buffer, which then grows.
+    bool _readCount(bool wait);
+
+    bool _mayOverflow() const;
+
+    int m_capacity = 0;
     int m_numTriangles = 0;
-    GLuint m_primitivesQuery;
+    int m_maxTriangles = INT_MAX;
+    bool m_queryPending = false;
+    bool m_counting = false; // Whether the current tessellation is counted
+    GLuint m_primitivesQuery = 0;
+    GLuint m_feedbackID = 0;
     GLuint m_vaoID = 0;
     GLuint m_bufferID = 0;
 };
@@ -35,6 +35,11 @@ void Texture::createColorTexture(int width, int height, GLint magFilter, GLint m
     _create(0, GL_RGBA, width, height, GL_RGBA, GL_UNSIGNED_BYTE, magFilter, minFilter);
 }
 
+void Texture::createFloatTexture(int width, int height, GLint magFilter, GLint minFilter)
+{
+    _create(0, GL_RGBA16F, width, height, GL_RGBA, GL_FLOAT, magFilter, minFilter);
+}
+
 void Texture::createDepthTexture(int width, int height, GLint magFilter, GLint minFilter)
 {
     _create(0, GL_DEPTH_COMPONENT16, width, height, GL_DEPTH_COMPONENT, GL_FLOAT, magFilter, minFilter);
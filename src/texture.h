@@ -21,6 +21,9 @@ public:
     // Creates a black texture with the given width and height.
     void createColorTexture(int width, int height, GLint magFilter, GLint minFilter);
 
+    // Creates a floating point (RGBA16F) texture, e.g. to accumulate colors into.
+    void createFloatTexture(int width, int height, GLint magFilter, GLint minFilter);
+
     void createDepthTexture(int width, int height, GLint magFilter, GLint minFilter);
 
     // updates the stored texture to reflect changes to m_image
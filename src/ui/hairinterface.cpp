@@ -4,8 +4,8 @@
 #include "ui_sceneeditor.h"
 #include "sceneeditor.h"
 #include "glwidget.h"
+#include "renderer.h"
 #include "hairobject.h"
-#include "hair.h"
 #include "simulation.h"
 #include "objmesh.h"
 
@@ -81,6 +81,9 @@ void HairInterface::connectUserInputs()
     connect(m_ui->shadowCheckBox, SIGNAL(toggled(bool)), this, SLOT(setShadows(bool)));
     connect(m_ui->supersampleCheckBox, SIGNAL(toggled(bool)), this, SLOT(setSupersampling(bool)));
     connect(m_ui->transparencyCheckBox, SIGNAL(toggled(bool)), this, SLOT(toggleTransparency(bool)));
+    connect(m_ui->blendedTransparencyCheckBox, SIGNAL(toggled(bool)), this, SLOT(toggleBlendedTransparency(bool)));
+    connect(m_ui->levelOfDetailCheckBox, SIGNAL(toggled(bool)), this, SLOT(toggleLevelOfDetail(bool)));
+    connect(m_ui->cullingCheckBox, SIGNAL(toggled(bool)), this, SLOT(toggleCulling(bool)));
     connect(m_ui->hairColorVariationCheckBox, SIGNAL(toggled(bool)), this, SLOT(toggleHairColorVariation(bool)));
     
     // buttons
@@ -121,29 +124,32 @@ void HairInterface::setHairObject(HairObject *hairObject)
     m_ui->inputHairColorR->setText(QString::number(m_hairObject->m_color.x*255, 'g', 2));
     m_ui->inputHairColorG->setText(QString::number(m_hairObject->m_color.y, 'g', 2));
     m_ui->inputHairColorB->setText(QString::number(m_hairObject->m_color.z, 'g', 2));
-    m_ui->sliderWindMagnitude->setValue(m_glWidget->m_testSimulation->m_windMagnitude*100);
-    m_ui->inputWindMagnitude->setText(QString::number(m_glWidget->m_testSimulation->m_windMagnitude, 'g', 3));
-    m_ui->sliderShadowIntensity->setValue(m_glWidget->m_hairObject->m_shadowIntensity*10);
-    m_ui->inputShadowIntensity->setText(QString::number(m_glWidget->m_hairObject->m_shadowIntensity, 'g', 3));
-    m_ui->sliderDiffuseIntensity->setValue(m_glWidget->m_hairObject->m_diffuseIntensity*100);
-    m_ui->inputDiffuseIntensity->setText(QString::number(m_glWidget->m_hairObject->m_diffuseIntensity, 'g', 3));
-    m_ui->sliderSpecularIntensity->setValue(m_glWidget->m_hairObject->m_specularIntensity*100);
-    m_ui->inputSpecularIntensity->setText(QString::number(m_glWidget->m_hairObject->m_specularIntensity, 'g', 3));
-    m_ui->sliderStiffness->setValue(m_glWidget->m_testSimulation->m_stiffness*1000);
-    m_ui->inputStiffness->setText(QString::number(m_glWidget->m_testSimulation->m_stiffness, 'g', 4));
+    m_ui->sliderWindMagnitude->setValue(m_glWidget->m_renderer->m_testSimulation->m_windMagnitude*100);
+    m_ui->inputWindMagnitude->setText(QString::number(m_glWidget->m_renderer->m_testSimulation->m_windMagnitude, 'g', 3));
+    m_ui->sliderShadowIntensity->setValue(m_glWidget->m_renderer->m_hairObject->m_shadowIntensity*10);
+    m_ui->inputShadowIntensity->setText(QString::number(m_glWidget->m_renderer->m_hairObject->m_shadowIntensity, 'g', 3));
+    m_ui->sliderDiffuseIntensity->setValue(m_glWidget->m_renderer->m_hairObject->m_diffuseIntensity*100);
+    m_ui->inputDiffuseIntensity->setText(QString::number(m_glWidget->m_renderer->m_hairObject->m_diffuseIntensity, 'g', 3));
+    m_ui->sliderSpecularIntensity->setValue(m_glWidget->m_renderer->m_hairObject->m_specularIntensity*100);
+    m_ui->inputSpecularIntensity->setText(QString::number(m_glWidget->m_renderer->m_hairObject->m_specularIntensity, 'g', 3));
+    m_ui->sliderStiffness->setValue(m_glWidget->m_renderer->m_testSimulation->m_stiffness*1000);
+    m_ui->inputStiffness->setText(QString::number(m_glWidget->m_renderer->m_testSimulation->m_stiffness, 'g', 4));
     m_ui->sliderTransparency->setValue(m_hairObject->m_transparency*1000);
     m_ui->inputTransparency->setText(QString::number(m_hairObject->m_transparency, 'g', 4));
     m_ui->sliderHairColorVariation->setValue(m_hairObject->m_hairColorVariation*1000);
     m_ui->inputHairColorVariation->setText(QString::number(m_hairObject->m_hairColorVariation, 'g', 4));
-    m_ui->inputWindDirectionX->setText(QString::number(m_glWidget->m_testSimulation->m_windDir.x, 'g', 4));
-    m_ui->inputWindDirectionY->setText(QString::number(m_glWidget->m_testSimulation->m_windDir.y, 'g', 4));
-    m_ui->inputWindDirectionZ->setText(QString::number(m_glWidget->m_testSimulation->m_windDir.z, 'g', 4));
+    m_ui->inputWindDirectionX->setText(QString::number(m_glWidget->m_renderer->m_testSimulation->m_windDir.x, 'g', 4));
+    m_ui->inputWindDirectionY->setText(QString::number(m_glWidget->m_renderer->m_testSimulation->m_windDir.y, 'g', 4));
+    m_ui->inputWindDirectionZ->setText(QString::number(m_glWidget->m_renderer->m_testSimulation->m_windDir.z, 'g', 4));
     
     // Sync toggles
-    m_ui->frictionSimCheckBox->setChecked(m_glWidget->useFrictionSim);
-    m_ui->shadowCheckBox->setChecked(m_glWidget->useShadows);
-    m_ui->supersampleCheckBox->setChecked(m_glWidget->useSupersampling);
-    m_ui->transparencyCheckBox->setChecked(m_glWidget->useTransparency);
+    m_ui->frictionSimCheckBox->setChecked(m_glWidget->m_renderer->useFrictionSim);
+    m_ui->shadowCheckBox->setChecked(m_glWidget->m_renderer->useShadows);
+    m_ui->supersampleCheckBox->setChecked(m_glWidget->m_renderer->useSupersampling);
+    m_ui->transparencyCheckBox->setChecked(m_glWidget->m_renderer->useTransparency);
+    m_ui->blendedTransparencyCheckBox->setChecked(m_glWidget->m_renderer->useBlendedTransparency);
+    m_ui->levelOfDetailCheckBox->setChecked(m_glWidget->m_renderer->useLevelOfDetail);
+    m_ui->cullingCheckBox->setChecked(m_glWidget->m_renderer->useCulling);
     m_ui->hairColorVariationCheckBox->setChecked(m_hairObject->m_useHairColorVariation);
     
     updateStatsLabel();
@@ -169,15 +175,16 @@ void HairInterface::updateFPSLabelPaused(float fps)
 void HairInterface::updateStatsLabel()
 {
     // Update stats label.
-    int numGuideHairs = m_hairObject->m_guideHairs.size();
+    int numGuideHairs = m_hairObject->m_guideHairs.numStrands();
+    int numStrands = m_hairObject->m_renderHairs.numStrands();
     int numGroupHairs = m_hairObject->m_numGroupHairs;
-    int numGuideVertices = m_hairObject->m_guideHairs[0]->m_vertices.size();
+    int numGuideVertices = m_hairObject->m_guideHairs.numVertices();
     int numSplineVertices = m_hairObject->m_numSplineVertices;
     m_ui->statsLabel->setText(
                 QString::number(numGuideHairs) + " guide hairs\n" +
-                QString::number(numGuideHairs * numGroupHairs) + " rendered hairs\n" +
-                QString::number(numGuideHairs * numGuideVertices) + " simulated vertices\n" +
-                QString::number(numGuideHairs * numGroupHairs * (numSplineVertices-1) * 2) + " rendered triangles");
+                QString::number(numStrands * numGroupHairs) + " rendered hairs\n" +
+                QString::number(numGuideVertices) + " simulated vertices\n" +
+                QString::number(numStrands * numGroupHairs * (numSplineVertices-1) * 2) + " rendered triangles");
 }
 
 void HairInterface::resetSimulation()
@@ -404,16 +411,16 @@ void HairInterface::inputWindMagnitudeText(QString text)
     bool ok;
     double value = text.toDouble(&ok);
     if (!ok){
-        value = m_glWidget->m_testSimulation->m_windMagnitude;
-    } else if (value == m_glWidget->m_testSimulation->m_windMagnitude) return;
+        value = m_glWidget->m_renderer->m_testSimulation->m_windMagnitude;
+    } else if (value == m_glWidget->m_renderer->m_testSimulation->m_windMagnitude) return;
     setWindMagnitude(100*value);
     m_ui->sliderWindMagnitude->setValue(100*value);
 }
 void HairInterface::setWindMagnitude(int value)
 {
     if (value < 0) return;
-    m_glWidget->m_testSimulation->m_windMagnitude = value/100.;
-    m_ui->inputWindMagnitude->setText(QString::number(m_glWidget->m_testSimulation->m_windMagnitude, 'g', 3));
+    m_glWidget->m_renderer->m_testSimulation->m_windMagnitude = value/100.;
+    m_ui->inputWindMagnitude->setText(QString::number(m_glWidget->m_renderer->m_testSimulation->m_windMagnitude, 'g', 3));
 }
 
 void HairInterface::inputWindDirectionXText(QString text)
@@ -422,9 +429,9 @@ void HairInterface::inputWindDirectionXText(QString text)
     bool ok;
     double value = text.toDouble(&ok);
     if (!ok){
-        value = m_glWidget->m_testSimulation->m_windDir.x;
-    } else if (value == m_glWidget->m_testSimulation->m_windDir.x) return;
-    m_glWidget->m_testSimulation->m_windDir.x = value;
+        value = m_glWidget->m_renderer->m_testSimulation->m_windDir.x;
+    } else if (value == m_glWidget->m_renderer->m_testSimulation->m_windDir.x) return;
+    m_glWidget->m_renderer->m_testSimulation->m_windDir.x = value;
 }
 void HairInterface::inputWindDirectionYText(QString text)
 {
@@ -432,9 +439,9 @@ void HairInterface::inputWindDirectionYText(QString text)
     bool ok;
     double value = text.toDouble(&ok);
     if (!ok){
-        value = m_glWidget->m_testSimulation->m_windDir.y;
-    } else if (value == m_glWidget->m_testSimulation->m_windDir.y) return;
-    m_glWidget->m_testSimulation->m_windDir.y = value;
+        value = m_glWidget->m_renderer->m_testSimulation->m_windDir.y;
+    } else if (value == m_glWidget->m_renderer->m_testSimulation->m_windDir.y) return;
+    m_glWidget->m_renderer->m_testSimulation->m_windDir.y = value;
 }
 void HairInterface::inputWindDirectionZText(QString text)
 {
@@ -442,9 +449,9 @@ void HairInterface::inputWindDirectionZText(QString text)
     bool ok;
     double value = text.toDouble(&ok);
     if (!ok){
-        value = m_glWidget->m_testSimulation->m_windDir.z;
-    } else if (value == m_glWidget->m_testSimulation->m_windDir.z) return;
-    m_glWidget->m_testSimulation->m_windDir.z = value;
+        value = m_glWidget->m_renderer->m_testSimulation->m_windDir.z;
+    } else if (value == m_glWidget->m_renderer->m_testSimulation->m_windDir.z) return;
+    m_glWidget->m_renderer->m_testSimulation->m_windDir.z = value;
 }
 
 void HairInterface::inputShadowIntensityText(QString text)
@@ -453,16 +460,16 @@ void HairInterface::inputShadowIntensityText(QString text)
     bool ok;
     double value = text.toDouble(&ok);
     if (!ok){
-        value = m_glWidget->m_hairObject->m_shadowIntensity;
-    } else if (value == m_glWidget->m_hairObject->m_shadowIntensity) return;
+        value = m_glWidget->m_renderer->m_hairObject->m_shadowIntensity;
+    } else if (value == m_glWidget->m_renderer->m_hairObject->m_shadowIntensity) return;
     setShadowIntensity(10*value);
     m_ui->sliderShadowIntensity->setValue(10*value);
 }
 void HairInterface::setShadowIntensity(int value)
 {
     if (value < 0) return;    
-    m_glWidget->m_hairObject->m_shadowIntensity = value/10.;
-    m_ui->inputShadowIntensity->setText(QString::number(m_glWidget->m_hairObject->m_shadowIntensity, 'g', 3));
+    m_glWidget->m_renderer->m_hairObject->m_shadowIntensity = value/10.;
+    m_ui->inputShadowIntensity->setText(QString::number(m_glWidget->m_renderer->m_hairObject->m_shadowIntensity, 'g', 3));
     m_glWidget->forceUpdate();
 }
 
@@ -472,16 +479,16 @@ void HairInterface::inputDiffuseIntensityText(QString text)
     bool ok;
     double value = text.toDouble(&ok);
     if (!ok){
-        value = m_glWidget->m_hairObject->m_diffuseIntensity;
-    } else if (value == m_glWidget->m_hairObject->m_diffuseIntensity) return;
+        value = m_glWidget->m_renderer->m_hairObject->m_diffuseIntensity;
+    } else if (value == m_glWidget->m_renderer->m_hairObject->m_diffuseIntensity) return;
     setDiffuseIntensity(100*value);
     m_ui->sliderDiffuseIntensity->setValue(100*value);
 }
 void HairInterface::setDiffuseIntensity(int value)
 {
     if (value < 0) return;    
-    m_glWidget->m_hairObject->m_diffuseIntensity = value/100.;
-    m_ui->inputDiffuseIntensity->setText(QString::number(m_glWidget->m_hairObject->m_diffuseIntensity, 'g', 3));
+    m_glWidget->m_renderer->m_hairObject->m_diffuseIntensity = value/100.;
+    m_ui->inputDiffuseIntensity->setText(QString::number(m_glWidget->m_renderer->m_hairObject->m_diffuseIntensity, 'g', 3));
     m_glWidget->forceUpdate();
 }
 
@@ -491,16 +498,16 @@ void HairInterface::inputSpecularIntensityText(QString text)
     bool ok;
     double value = text.toDouble(&ok);
     if (!ok){
-        value = m_glWidget->m_hairObject->m_specularIntensity;
-    } else if (value == m_glWidget->m_hairObject->m_specularIntensity) return;
+        value = m_glWidget->m_renderer->m_hairObject->m_specularIntensity;
+    } else if (value == m_glWidget->m_renderer->m_hairObject->m_specularIntensity) return;
     setSpecularIntensity(100*value);
     m_ui->sliderSpecularIntensity->setValue(100*value);
 }
 void HairInterface::setSpecularIntensity(int value)
 {
     if (value < 0) return;    
-    m_glWidget->m_hairObject->m_specularIntensity = value/100.;
-    m_ui->inputSpecularIntensity->setText(QString::number(m_glWidget->m_hairObject->m_specularIntensity, 'g', 3));
+    m_glWidget->m_renderer->m_hairObject->m_specularIntensity = value/100.;
+    m_ui->inputSpecularIntensity->setText(QString::number(m_glWidget->m_renderer->m_hairObject->m_specularIntensity, 'g', 3));
     m_glWidget->forceUpdate();
 }
 
@@ -510,16 +517,16 @@ void HairInterface::inputStiffnessText(QString text)
     bool ok;
     double value = text.toDouble(&ok);
     if (!ok){
-        value = m_glWidget->m_testSimulation->m_stiffness;
-    } else if (value == m_glWidget->m_testSimulation->m_stiffness) return;
+        value = m_glWidget->m_renderer->m_testSimulation->m_stiffness;
+    } else if (value == m_glWidget->m_renderer->m_testSimulation->m_stiffness) return;
     setStiffness(1000*value);
     m_ui->sliderStiffness->setValue(1000*value);
 }
 void HairInterface::setStiffness(int value)
 {
     if (value < 0) return;    
-    m_glWidget->m_testSimulation->m_stiffness = value/1000.;
-    m_ui->inputStiffness->setText(QString::number(m_glWidget->m_testSimulation->m_stiffness, 'g', 3));
+    m_glWidget->m_renderer->m_testSimulation->m_stiffness = value/1000.;
+    m_ui->inputStiffness->setText(QString::number(m_glWidget->m_renderer->m_testSimulation->m_stiffness, 'g', 3));
 }
 
 void HairInterface::inputTransparencyText(QString text)
@@ -563,21 +570,36 @@ void HairInterface::setHairColorVariation(int value)
 
 void HairInterface::setShadows(bool checked)
 {
-    m_glWidget->useShadows = checked;
+    m_glWidget->m_renderer->useShadows = checked;
     m_glWidget->forceUpdate();
 }
 void HairInterface::setSupersampling(bool checked)
 {
-    m_glWidget->useSupersampling = checked;
+    m_glWidget->m_renderer->useSupersampling = checked;
     m_glWidget->forceUpdate();
 }
 void HairInterface::setFrictionSim(bool checked)
 {
-    m_glWidget->useFrictionSim = checked;
+    m_glWidget->m_renderer->useFrictionSim = checked;
 }
 void HairInterface::toggleTransparency(bool checked)
 {
-    m_glWidget->useTransparency = checked;
+    m_glWidget->m_renderer->useTransparency = checked;
+    m_glWidget->forceUpdate();
+}
+void HairInterface::toggleBlendedTransparency(bool checked)
+{
+    m_glWidget->m_renderer->useBlendedTransparency = checked;
+    m_glWidget->forceUpdate();
+}
+void HairInterface::toggleLevelOfDetail(bool checked)
+{
+    m_glWidget->m_renderer->useLevelOfDetail = checked;
+    m_glWidget->forceUpdate();
+}
+void HairInterface::toggleCulling(bool checked)
+{
+    m_glWidget->m_renderer->useCulling = checked;
     m_glWidget->forceUpdate();
 }
 void HairInterface::toggleHairColorVariation(bool checked)
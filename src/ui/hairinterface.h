@@ -74,6 +74,9 @@ public slots:
     void setSupersampling(bool);
     void setFrictionSim(bool);
     void toggleTransparency(bool checked);
+    void toggleBlendedTransparency(bool checked);
+    void toggleLevelOfDetail(bool checked);
+    void toggleCulling(bool checked);
     void toggleHairColorVariation(bool checked);
     
     void togglePaused();
@@ -1,4 +1,5 @@
 #include "glwidget.h"
+#include "renderer.h"
 
 #include "scenewidget.h"
 #include "QWidget"
@@ -51,10 +52,10 @@ void SceneWidget::initializeGL()
 {    
     
     m_densityMapTexture = new Texture();
-    m_densityMapTexture->createColorTexture(mainWidget->m_hairObject->m_hairGrowthMap, GL_LINEAR, GL_LINEAR);
+    m_densityMapTexture->createColorTexture(mainWidget->m_renderer->m_hairObject->m_hairGrowthMap, GL_LINEAR, GL_LINEAR);
     
     m_directionMapTexture = new Texture();
-    m_directionMapTexture->createColorTexture(mainWidget->m_hairObject->m_hairGroomingMap, GL_LINEAR, GL_LINEAR);
+    m_directionMapTexture->createColorTexture(mainWidget->m_renderer->m_hairObject->m_hairGroomingMap, GL_LINEAR, GL_LINEAR);
     
     m_currentTexture = m_densityMapTexture;
 }